@@ -0,0 +1,4 @@
+/* The scalability benchmark generates its own inputs, this file only gives Clava something to parse */
+int seed(void) {
+    return 0;
+}
@@ -1,12 +1,22 @@
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
-import { Call, FunctionJp, PointerType, TagType, Type, TypedefType } from "@specs-feup/clava/api/Joinpoints.js";
-import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { FunctionJp, Joinpoint, PointerType, TagType, Type, TypedefType } from "@specs-feup/clava/api/Joinpoints.js";
 import chalk from "chalk";
+import { AstPredicates } from "./AstPredicates.js";
+import { ChangeJournal } from "./ChangeJournal.js";
+import { InitializerBlobs } from "./InitializerBlobs.js";
+import { LogLevel, TransformLog } from "./TransformLog.js";
+import { buildPlan, PlanCandidate, TransformPlan } from "./TransformPlan.js";
+import { CallGraph } from "./program/CallGraph.js";
 
 export abstract class AdvancedTransform {
     private transformName: string = "AdvancedTransform";
     protected silent: boolean = false;
 
+    // shared by all transforms, so that any of them can take part in a TransformSession
+    protected static sessionDepth: number = 0;
+    protected static pendingRebuilds: number = 0;
+    protected static rebuildCount: number = 0;
+
     constructor(name: string, silent?: boolean) {
         this.transformName = name;
         this.silent = silent || false;
@@ -20,6 +30,13 @@ export abstract class AdvancedTransform {
         return this.silent;
     }
 
+    /**
+     * Number of times the AST was rebuilt by any transform since the program started
+     */
+    public static getRebuildCount(): number {
+        return AdvancedTransform.rebuildCount;
+    }
+
     public getTransformName(): string {
         return this.transformName;
     }
@@ -28,9 +45,38 @@ export abstract class AdvancedTransform {
         this.transformName = name;
     }
 
+    /**
+     * Records in the ChangeJournal that the function containing a joinpoint was changed by this transform.
+     * Changes outside of any function (e.g., to globals) may affect every function.
+     */
+    protected markDirty(jp: Joinpoint): void {
+        const fun = jp instanceof FunctionJp ? jp : jp.getAncestor("function") as FunctionJp | undefined;
+        if (fun == undefined) {
+            this.markAllDirty();
+            return;
+        }
+        ChangeJournal.record(fun, this.transformName);
+    }
+
+    protected markAllDirty(): void {
+        ChangeJournal.recordAll(this.transformName);
+    }
+
+    /**
+     * Builds the result of a plan phase, i.e., of a method that only analyses where and whether
+     * the transform can be applied, without changing the AST.
+     */
+    protected makePlan(candidates: PlanCandidate[], startTime: number): TransformPlan {
+        const plan = buildPlan(this.transformName, candidates, startTime);
+        const benefit = Object.entries(plan.estimatedBenefit).map(([metric, value]) => `${metric}=${value}`).join(", ");
+
+        this.log(`Plan: ${plan.legal} legal and ${plan.rejected} rejected candidate(s), estimated benefit {${benefit}}, in ${plan.planTimeMs} ms`);
+        return plan;
+    }
+
     protected simpleType(type: Type, removeSignedInfo: boolean = false): string {
-        const baseType = type.code
-            .replace("*", "")
+        // only the (small) base type is printed; arrays, qualifiers and one pointer level are removed structurally
+        const baseType = AstPredicates.baseTypeOf(type, 1).code
             .replace("struct ", "")
             .replace("const ", "")
             .replace("volatile ", "")
@@ -43,15 +89,27 @@ export abstract class AdvancedTransform {
         return baseType.replace("unsigned", "").replace("signed", "").trim();
     }
 
-    protected log(msg: string, level: "INFO" | "WARN" | "ERROR" = "INFO") {
-        if (this.silent && level === "INFO") {
+    /**
+     * Messages that interpolate .code, .location or anything else expensive should be given as a function,
+     * which is only called if the message passes the filters of TransformLog.
+     */
+    protected log(msg: string | (() => string), level: LogLevel = "INFO", data?: Record<string, unknown>) {
+        if (!TransformLog.isEnabled(level, this.silent)) {
             return;
         }
+        const text = typeof msg === "function" ? msg() : msg;
+        TransformLog.write({ time: Date.now(), transform: this.transformName, level: level, message: text, data: data });
 
+        if (!TransformLog.isConsoleOutput()) {
+            return;
+        }
         const withPrefix = `Transform-${this.transformName}`;
         const header = chalk.magentaBright(withPrefix);
         let levelColoured;
         switch (level) {
+            case "DEBUG":
+                levelColoured = ` ${chalk.gray(level)}:`;
+                break;
             case "INFO":
                 levelColoured = "";
                 break;
@@ -62,53 +120,55 @@ export abstract class AdvancedTransform {
                 levelColoured = ` ${chalk.redBright(level)}:`;
                 break;
         }
-        const message = `[${header}]${levelColoured} ${msg}`;
+        const message = `[${header}]${levelColoured} ${text}`;
         console.log(message);
     }
 
-    protected logWarning(msg: string) {
+    protected logDebug(msg: string | (() => string)) {
+        this.log(msg, "DEBUG");
+    }
+
+    protected logWarning(msg: string | (() => string)) {
         this.log(msg, "WARN");
     }
 
-    protected logError(msg: string) {
+    protected logError(msg: string | (() => string)) {
         this.log(msg, "ERROR");
     }
 
+    /**
+     * For guarding loops that only exist to build log messages
+     */
+    protected isLogEnabled(level: LogLevel = "INFO"): boolean {
+        return TransformLog.isEnabled(level, this.silent);
+    }
+
     protected logLine(len: number = 65) {
         this.log("-".repeat(len));
     }
 
     protected getFunctionChain(startingPoint: FunctionJp | undefined): FunctionJp[] {
-        const funs: FunctionJp[] = [];
+        const callGraph = CallGraph.get();
 
         if (startingPoint !== undefined) {
-
-            const stack = [startingPoint];
-            const visited = new Set<string>();
-
-            while (stack.length > 0) {
-                const currentFun = stack.pop()!;
-                if (visited.has(currentFun.name)) {
-                    continue;
-                }
-                visited.add(currentFun.name);
-                funs.push(currentFun);
-
-                const calledFuns = Query.searchFrom(currentFun, Call).get()
-                    .map(call => call.function)
-                    .filter(fun => fun != undefined && fun.isImplementation) as FunctionJp[];
-                stack.push(...calledFuns);
-            }
+            return callGraph.getReachable(startingPoint);
         }
-        else {
-            funs.push(...Query.search(FunctionJp).get().filter(fun => fun.isImplementation));
-        }
-        return funs;
+        return callGraph.getFunctions();
     }
 
     protected rebuildAfterTransform(): boolean {
+        // whatever the outcome, the old joinpoints are no longer the ones in the AST
+        CallGraph.invalidate();
+
+        if (AdvancedTransform.sessionDepth > 0) {
+            AdvancedTransform.pendingRebuilds++;
+            this.log(`Rebuild after applying ${this.transformName} deferred until the session is committed`);
+            return true;
+        }
+        AdvancedTransform.rebuildCount++;
         try {
             Clava.rebuild();
+            InitializerBlobs.recompact();
         } catch (e) {
             this.logError(`Error rebuilding code after applying ${this.transformName}`);
             console.log(e);
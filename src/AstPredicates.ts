@@ -0,0 +1,172 @@
+import { ArrayAccess, ArrayType, Break, BuiltinType, Continue, Expression, IntLiteral, Joinpoint, MemberAccess, ParenExpr, PointerType, QualType, Statement, Type, UnaryOp, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+
+/**
+ * Structural checks that replace comparisons on regenerated source code. Accessing .code
+ * pretty-prints the whole subtree, which is expensive when done for every statement or reference.
+ * The only fallback to .code is for statements created with stmtLiteral(), which have no children
+ * and are therefore cheap to print.
+ */
+export class AstPredicates {
+    public static isBreak(stmt: Joinpoint): boolean {
+        return stmt instanceof Break || AstPredicates.isLiteralStmt(stmt, "break;");
+    }
+
+    public static isContinue(stmt: Joinpoint): boolean {
+        return stmt instanceof Continue || AstPredicates.isLiteralStmt(stmt, "continue;");
+    }
+
+    /**
+     * Checks whether a statement is a childless statement (e.g., one created with stmtLiteral())
+     * whose code is the given one.
+     */
+    public static isLiteralStmt(stmt: Joinpoint, code: string): boolean {
+        if (!(stmt instanceof Statement) || stmt.children.length > 0) {
+            return false;
+        }
+        return stmt.code.trim() === code;
+    }
+
+    /**
+     * Checks whether a type is void, after removing typedefs and qualifiers.
+     * Pointers to void are not void.
+     */
+    public static isVoidType(type: Type): boolean {
+        let desugared = type.desugarAll;
+        if (desugared instanceof QualType) {
+            desugared = desugared.unqualifiedType.desugarAll;
+        }
+        return desugared instanceof BuiltinType && desugared.isVoid;
+    }
+
+    /**
+     * Returns the type left after removing arrays, qualifiers, and up to maxPointers levels of pointers.
+     */
+    public static baseTypeOf(type: Type, maxPointers: number = Number.MAX_SAFE_INTEGER): Type {
+        let current = type;
+        let pointers = 0;
+
+        while (true) {
+            if (current instanceof ArrayType) {
+                current = current.elementType;
+            }
+            else if (current instanceof QualType) {
+                current = current.unqualifiedType;
+            }
+            else if (current instanceof PointerType && pointers < maxPointers) {
+                current = current.pointee;
+                pointers++;
+            }
+            else {
+                return current;
+            }
+        }
+    }
+
+    /**
+     * Checks whether two expressions denote the same lvalue, i.e., the same variable, field,
+     * array element or dereference. Subscripts must be the same variable or the same integer literal,
+     * so this can give false negatives, but never false positives.
+     */
+    public static isSameLvalue(a: Expression, b: Expression): boolean {
+        a = AstPredicates.stripParens(a);
+        b = AstPredicates.stripParens(b);
+
+        if (a.astId === b.astId) {
+            return true;
+        }
+        if (a instanceof Varref && b instanceof Varref) {
+            const declA = a.vardecl;
+            const declB = b.vardecl;
+            if (declA != undefined && declB != undefined) {
+                return declA.astId === declB.astId;
+            }
+            return a.name === b.name;
+        }
+        if (a instanceof MemberAccess && b instanceof MemberAccess) {
+            return a.name === b.name && a.arrow === b.arrow && AstPredicates.isSameLvalue(a.base, b.base);
+        }
+        if (a instanceof ArrayAccess && b instanceof ArrayAccess) {
+            if (a.subscript.length !== b.subscript.length || !AstPredicates.isSameLvalue(a.arrayVar, b.arrayVar)) {
+                return false;
+            }
+            return a.subscript.every((sub, i) => AstPredicates.isSameIndex(sub, b.subscript[i]));
+        }
+        if (a instanceof UnaryOp && b instanceof UnaryOp) {
+            return a.operator === "*" && b.operator === "*" && AstPredicates.isSameLvalue(a.operand, b.operand);
+        }
+        return false;
+    }
+
+    private static isSameIndex(a: Expression, b: Expression): boolean {
+        a = AstPredicates.stripParens(a);
+        b = AstPredicates.stripParens(b);
+
+        if (a instanceof IntLiteral && b instanceof IntLiteral) {
+            return a.value === b.value;
+        }
+        return AstPredicates.isSameLvalue(a, b);
+    }
+
+    private static stripParens(expr: Expression): Expression {
+        while (expr instanceof ParenExpr) {
+            expr = expr.subExpr;
+        }
+        return expr;
+    }
+}
+
+/**
+ * Counts how many times .code is accessed on any joinpoint, to find passes that regenerate
+ * source code inside their analyses. Counting wraps the .code getter, so it is opt-in.
+ */
+export class CodeMaterializationCounter {
+    private static count: number = 0;
+    private static owner: object | undefined = undefined;
+    private static original: PropertyDescriptor | undefined = undefined;
+
+    public static enable(): void {
+        if (CodeMaterializationCounter.original != undefined) {
+            return;
+        }
+        let owner: object | null = Joinpoint.prototype;
+        while (owner != null && Object.getOwnPropertyDescriptor(owner, "code") == undefined) {
+            owner = Object.getPrototypeOf(owner);
+        }
+        const original = owner != null ? Object.getOwnPropertyDescriptor(owner, "code") : undefined;
+        if (owner == null || original?.get == undefined) {
+            return;
+        }
+        const originalGetter = original.get;
+
+        Object.defineProperty(owner, "code", {
+            ...original,
+            get: function (this: Joinpoint) {
+                CodeMaterializationCounter.count++;
+                return originalGetter.call(this);
+            }
+        });
+        CodeMaterializationCounter.owner = owner;
+        CodeMaterializationCounter.original = original;
+    }
+
+    public static disable(): void {
+        if (CodeMaterializationCounter.owner == undefined || CodeMaterializationCounter.original == undefined) {
+            return;
+        }
+        Object.defineProperty(CodeMaterializationCounter.owner, "code", CodeMaterializationCounter.original);
+        CodeMaterializationCounter.owner = undefined;
+        CodeMaterializationCounter.original = undefined;
+    }
+
+    public static isEnabled(): boolean {
+        return CodeMaterializationCounter.original != undefined;
+    }
+
+    public static getCount(): number {
+        return CodeMaterializationCounter.count;
+    }
+
+    public static reset(): void {
+        CodeMaterializationCounter.count = 0;
+    }
+}
@@ -0,0 +1,88 @@
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import { CallGraph } from "./program/CallGraph.js";
+
+/**
+ * Program-wide record of which functions each transform changed, kept by AdvancedTransform.
+ * Functions are tracked by name, so the journal survives AST rebuilds. A mark is a point in the
+ * sequence of changes: a driver takes a mark, runs some passes, and then only revisits the functions
+ * changed since that mark (and possibly their callers), instead of every function in the program.
+ * Changes that may affect any function, such as to a global declaration, mark every function as changed.
+ */
+export class ChangeJournal {
+    private static seq: number = 0;
+    private static lastChanged: Map<string, number> = new Map();
+    private static allChangedAt: number = 0;
+    private static changesByTransform: Map<string, Set<string>> = new Map();
+
+    public static mark(): number {
+        return ChangeJournal.seq;
+    }
+
+    public static record(fun: FunctionJp | string, transform: string): void {
+        const name = typeof fun === "string" ? fun : fun.name;
+        ChangeJournal.lastChanged.set(name, ++ChangeJournal.seq);
+
+        if (!ChangeJournal.changesByTransform.has(transform)) {
+            ChangeJournal.changesByTransform.set(transform, new Set());
+        }
+        ChangeJournal.changesByTransform.get(transform)!.add(name);
+    }
+
+    public static recordAll(transform: string): void {
+        ChangeJournal.allChangedAt = ++ChangeJournal.seq;
+        ChangeJournal.record("*", transform);
+    }
+
+    public static isDirtySince(fun: FunctionJp | string, mark: number): boolean {
+        if (ChangeJournal.allChangedAt > mark) {
+            return true;
+        }
+        const name = typeof fun === "string" ? fun : fun.name;
+        return (ChangeJournal.lastChanged.get(name) ?? 0) > mark;
+    }
+
+    /**
+     * @returns the names of the functions changed since the mark, or undefined if every function may have changed
+     */
+    public static getDirtySince(mark: number): string[] | undefined {
+        if (ChangeJournal.allChangedAt > mark) {
+            return undefined;
+        }
+        return Array.from(ChangeJournal.lastChanged.entries())
+            .filter(([name, seq]) => seq > mark && name !== "*")
+            .map(([name]) => name);
+    }
+
+    /**
+     * Keeps only the functions changed since the mark and, optionally, the functions that call them,
+     * since facts about a callee (e.g., its side effects) may be used by the analysis of its callers.
+     */
+    public static filterDirty(funs: FunctionJp[], mark: number, includeCallers: boolean = true): FunctionJp[] {
+        const dirty = ChangeJournal.getDirtySince(mark);
+        if (dirty == undefined) {
+            return funs;
+        }
+        const names = new Set(dirty);
+        if (includeCallers) {
+            const graph = CallGraph.get();
+            for (const name of dirty) {
+                graph.getCallers(name).forEach((caller) => names.add(caller.name));
+            }
+        }
+        return funs.filter((fun) => names.has(fun.name));
+    }
+
+    /**
+     * Functions changed by each transform since the journal was last cleared ("*" means every function)
+     */
+    public static getChangesByTransform(): Map<string, Set<string>> {
+        return ChangeJournal.changesByTransform;
+    }
+
+    public static clear(): void {
+        ChangeJournal.lastChanged.clear();
+        ChangeJournal.changesByTransform.clear();
+        // the sequence keeps going, so that marks taken before clearing stay meaningful
+        ChangeJournal.allChangedAt = 0;
+    }
+}
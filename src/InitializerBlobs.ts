@@ -0,0 +1,260 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { ArrayType, ExprLiteral, FileJp, FunctionJp, InitList, Param, QualType, Type, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+
+/**
+ * A large initializer list kept as a single literal. The elements are parsed from the source once,
+ * and are kept in row-major order, so reshaping the array (e.g., flattening it) does not change them.
+ */
+export type InitializerBlob = {
+    key: string,
+    dims: number[],
+    // undefined if the initializer could not be parsed into one value per element (e.g., strings, nested structs)
+    values: string[] | undefined,
+    text: string,
+    isConst: boolean
+}
+
+export type InitializerBlobStats = {
+    blobs: number,
+    elements: number,
+    compactions: number
+}
+
+/**
+ * Program-wide registry of large initializer lists, e.g., lookup tables and training sets.
+ * Each of them is replaced by a single literal joinpoint instead of one joinpoint per element,
+ * so that transforms, folding and rebuilds do not crawl through them. A rebuild reparses the code
+ * and expands the initializers again; recompact() then puts the blobs back without reading their code.
+ * Blobs are tracked by file and variable name (qualified by function for locals), so the registry survives
+ * rebuilds. Declarations that share a key (e.g., same-named locals in different scopes of a function) are
+ * never compacted, and a blob is only matched to a declaration with a compacted initializer and the same
+ * dimensions, so that the elements of one table are never taken for those of another.
+ */
+export class InitializerBlobs {
+    public static readonly DEFAULT_THRESHOLD: number = 50;
+
+    private static blobs: Map<string, InitializerBlob> = new Map();
+    private static compactions: number = 0;
+
+    /**
+     * Compacts every initializer list with at least threshold elements (at the top level), as well as
+     * those of already known blobs, which may have been expanded by a rebuild.
+     * @returns the number of initializers compacted
+     */
+    public static compactAll(threshold: number = InitializerBlobs.DEFAULT_THRESHOLD): number {
+        const ambiguous = InitializerBlobs.findAmbiguousKeys();
+        let cnt = 0;
+
+        for (const decl of Query.search(Vardecl)) {
+            if (decl instanceof Param || decl.numChildren == 0 || !(decl.children[0] instanceof InitList)) {
+                continue;
+            }
+            const initList = decl.children[0] as InitList;
+            const key = InitializerBlobs.keyOf(decl);
+            if (ambiguous.has(key)) {
+                InitializerBlobs.blobs.delete(key);
+                continue;
+            }
+            if (InitializerBlobs.isCompacted(initList)) {
+                continue;
+            }
+            let known = InitializerBlobs.blobs.get(key);
+            if (known != undefined && !InitializerBlobs.sameDims(decl, known)) {
+                // another declaration took the name of the blob's array
+                InitializerBlobs.blobs.delete(key);
+                known = undefined;
+            }
+
+            if (known != undefined) {
+                InitializerBlobs.replaceInit(initList, known.text);
+                cnt++;
+            }
+            else if (initList.numChildren >= threshold) {
+                InitializerBlobs.register(decl, initList.code);
+                InitializerBlobs.replaceInit(initList, InitializerBlobs.blobs.get(key)!.text);
+                cnt++;
+            }
+        }
+        InitializerBlobs.compactions += cnt;
+        return cnt;
+    }
+
+    /**
+     * Puts back the known blobs after a rebuild. Does nothing, not even searching the AST, if there are none.
+     */
+    public static recompact(): number {
+        if (InitializerBlobs.blobs.size == 0) {
+            return 0;
+        }
+        return InitializerBlobs.compactAll(Number.MAX_SAFE_INTEGER);
+    }
+
+    public static isBlob(decl: Vardecl): boolean {
+        return InitializerBlobs.getBlob(decl) != undefined;
+    }
+
+    /**
+     * @returns the blob of a declaration, or undefined if its initializer is not compacted (e.g., it is
+     * another declaration with the same key) or its dimensions are not those of the blob
+     */
+    public static getBlob(decl: Vardecl): InitializerBlob | undefined {
+        const blob = InitializerBlobs.blobs.get(InitializerBlobs.keyOf(decl));
+        if (blob == undefined || decl.numChildren == 0 || !InitializerBlobs.sameDims(decl, blob)) {
+            return undefined;
+        }
+        const init = decl.children[0];
+        // after reshape(), the initializer is the literal itself
+        const isCompacted = init instanceof ExprLiteral || (init instanceof InitList && InitializerBlobs.isCompacted(init));
+        return isCompacted ? blob : undefined;
+    }
+
+    /**
+     * Value of an element of a blob, given one subscript per dimension.
+     * Elements left out of a one-dimensional initializer are zero.
+     */
+    public static elementAt(blob: InitializerBlob, subscripts: number[]): string | undefined {
+        if (blob.values == undefined || subscripts.length != blob.dims.length) {
+            return undefined;
+        }
+        let index = 0;
+        for (let i = 0; i < subscripts.length; i++) {
+            if (subscripts[i] < 0 || (blob.dims[i] > 0 && subscripts[i] >= blob.dims[i])) {
+                return undefined;
+            }
+            index = index * Math.max(blob.dims[i], 1) + subscripts[i];
+        }
+        return index < blob.values.length ? blob.values[index] : "0";
+    }
+
+    /**
+     * Changes the dimensions of a blob, e.g., when flattening its array, and returns the new
+     * initializer, with the same elements in the same order and no nested braces.
+     */
+    public static reshape(decl: Vardecl, dims: number[]): ExprLiteral {
+        const blob = InitializerBlobs.getBlob(decl)!;
+        blob.dims = dims;
+        blob.text = blob.values != undefined ? `{${blob.values.join(", ")}}` : `{${blob.text.replace(/[{}]/g, "")}}`;
+
+        return ClavaJoinPoints.exprLiteral(blob.text);
+    }
+
+    public static getStats(): InitializerBlobStats {
+        let elements = 0;
+        InitializerBlobs.blobs.forEach((blob) => elements += blob.values?.length ?? 0);
+        return { blobs: InitializerBlobs.blobs.size, elements: elements, compactions: InitializerBlobs.compactions };
+    }
+
+    public static getBlobs(): InitializerBlob[] {
+        return Array.from(InitializerBlobs.blobs.values());
+    }
+
+    public static clear(): void {
+        InitializerBlobs.blobs.clear();
+        InitializerBlobs.compactions = 0;
+    }
+
+    public static keyOf(decl: Vardecl): string {
+        const file = decl.getAncestor("file") as FileJp | undefined;
+        const prefix = file != undefined ? `${file.name}::` : "";
+        if (decl.isGlobal) {
+            return `${prefix}${decl.name}`;
+        }
+        const fun = decl.getAncestor("function") as FunctionJp | undefined;
+        return fun != undefined ? `${prefix}${fun.name}::${decl.name}` : `${prefix}${decl.name}`;
+    }
+
+    /**
+     * Keys shared by more than one declaration, whose blobs cannot be told apart after a rebuild
+     */
+    private static findAmbiguousKeys(): Set<string> {
+        const seen = new Set<string>();
+        const ambiguous = new Set<string>();
+
+        for (const decl of Query.search(Vardecl)) {
+            if (decl instanceof Param || (decl.isGlobal && !decl.hasInit)) {
+                // extern declarations and tentative definitions refer to the same global
+                continue;
+            }
+            const key = InitializerBlobs.keyOf(decl);
+            if (seen.has(key)) {
+                ambiguous.add(key);
+            }
+            seen.add(key);
+        }
+        return ambiguous;
+    }
+
+    private static dimsOf(decl: Vardecl): number[] {
+        return decl.type.isArray ? decl.type.arrayDims : [];
+    }
+
+    private static sameDims(decl: Vardecl, blob: InitializerBlob): boolean {
+        const dims = InitializerBlobs.dimsOf(decl);
+        return dims.length == blob.dims.length && dims.every((dim, i) => dim == blob.dims[i]);
+    }
+
+    private static register(decl: Vardecl, text: string): void {
+        const dims = InitializerBlobs.dimsOf(decl);
+        const values = InitializerBlobs.parseElements(text);
+        const size = dims.reduce((acc, dim) => acc * dim, 1);
+
+        // with nested braces, a partial initializer has no simple row-major order
+        const complete = values != undefined && dims.length > 0 && (values.length == size || (dims.length == 1 && values.length <= size));
+
+        InitializerBlobs.blobs.set(InitializerBlobs.keyOf(decl), {
+            key: InitializerBlobs.keyOf(decl),
+            dims: dims,
+            values: complete ? values : undefined,
+            text: text,
+            isConst: InitializerBlobs.isConstArray(decl.type)
+        });
+    }
+
+    private static isCompacted(initList: InitList): boolean {
+        return initList.numChildren == 1 && initList.children[0] instanceof ExprLiteral;
+    }
+
+    private static replaceInit(initList: InitList, text: string): void {
+        // the list prints its own outer braces around the literal
+        const elements = text.substring(text.indexOf("{") + 1, text.lastIndexOf("}"));
+        initList.removeChildren();
+        initList.setFirstChild(ClavaJoinPoints.exprLiteral(elements));
+    }
+
+    /**
+     * Splits an initializer into its scalar elements, ignoring braces.
+     * Returns undefined for initializers with strings, characters, designators or parentheses,
+     * since their elements cannot be split on commas alone.
+     */
+    public static parseElements(text: string): string[] | undefined {
+        if (/["'=()]/.test(text)) {
+            return undefined;
+        }
+        const values: string[] = [];
+        for (const elem of text.split(/[{},]/)) {
+            const value = elem.trim();
+            if (value.length == 0) {
+                continue;
+            }
+            values.push(value);
+        }
+        return values;
+    }
+
+    public static isConstArray(type: Type): boolean {
+        let current = type;
+        while (current instanceof ArrayType || current instanceof QualType) {
+            if (current instanceof QualType) {
+                if (current.qualifiers.includes("const")) {
+                    return true;
+                }
+                current = current.unqualifiedType;
+            }
+            else {
+                current = current.elementType;
+            }
+        }
+        return false;
+    }
+}
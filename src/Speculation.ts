@@ -0,0 +1,107 @@
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "./AdvancedTransform.js";
+import { CallGraph } from "./program/CallGraph.js";
+
+export type SpeculationResult<T> = {
+    accepted: boolean,
+    result: T | undefined
+}
+
+export type SpeculationStats = {
+    attempts: number,
+    accepted: number,
+    rolledBack: number,
+    restoreTimeMs: number
+}
+
+/**
+ * Deep copies of a set of functions, plus the list of functions that existed when it was taken.
+ * Restoring puts the copies back in place of the (possibly modified) functions, and removes
+ * any function or prototype created since, such as inlining clones or outlined functions.
+ */
+export class FunctionSnapshot {
+    private copies: [FunctionJp, FunctionJp][] = [];
+    private existing: Set<string> = new Set();
+
+    constructor(funs: FunctionJp[]) {
+        for (const fun of funs) {
+            this.copies.push([fun, fun.copy() as FunctionJp]);
+        }
+        for (const fun of Query.search(FunctionJp)) {
+            this.existing.add(fun.astId);
+        }
+    }
+
+    /**
+     * @returns the number of functions that were put back or removed
+     */
+    public restore(): number {
+        let n = 0;
+        for (const fun of Query.search(FunctionJp).get()) {
+            if (!this.existing.has(fun.astId)) {
+                fun.detach();
+                n++;
+            }
+        }
+        for (const [current, copy] of this.copies) {
+            current.replaceWith(copy);
+            n++;
+        }
+        this.copies = [];
+        CallGraph.invalidate();
+        return n;
+    }
+}
+
+/**
+ * Runs a transform speculatively: the functions it touches are snapshotted first and, if the
+ * transform fails, throws, or produces a result that is not accepted, only those functions are
+ * restored, instead of leaving the AST half-transformed or reparsing the whole program.
+ *
+ * Joinpoints inside restored functions that were obtained before the attempt (e.g., calls) are no
+ * longer in the AST afterwards, and must be searched for again.
+ */
+export class Speculation extends AdvancedTransform {
+    private stats: SpeculationStats = { attempts: 0, accepted: 0, rolledBack: 0, restoreTimeMs: 0 };
+
+    constructor(silent: boolean = false) {
+        super("Speculation", silent);
+    }
+
+    /**
+     * @param funs the functions the action may change; functions it creates do not need to be listed
+     * @param action the transform to try
+     * @param isAccepted validates the result of the action, e.g., a legality or profitability check
+     */
+    public attempt<T>(funs: FunctionJp[], action: () => T, isAccepted: (result: T) => boolean = (result) => Boolean(result)): SpeculationResult<T> {
+        this.stats.attempts++;
+        const snapshot = new FunctionSnapshot(funs);
+
+        let result: T | undefined = undefined;
+        let accepted = false;
+        try {
+            result = action();
+            accepted = isAccepted(result);
+        } catch (e) {
+            this.logError(`Speculative transform threw: ${e}`);
+        }
+
+        if (accepted) {
+            this.stats.accepted++;
+            return { accepted: true, result: result };
+        }
+
+        const start = Date.now();
+        const n = snapshot.restore();
+        this.stats.rolledBack++;
+        this.stats.restoreTimeMs += Date.now() - start;
+        this.log(`Rolled back ${n} function(s) touched by a rejected transform`);
+
+        return { accepted: false, result: result };
+    }
+
+    public getStats(): SpeculationStats {
+        return this.stats;
+    }
+}
@@ -0,0 +1,85 @@
+import fs from "node:fs";
+
+export type LogLevel = "DEBUG" | "INFO" | "WARN" | "ERROR";
+
+/**
+ * A log message as written to the JSONL sink, one per line
+ */
+export type LogEvent = {
+    time: number,
+    transform: string,
+    level: LogLevel,
+    message: string,
+    data?: Record<string, unknown>
+}
+
+const LEVEL_ORDER: Record<LogLevel, number> = { DEBUG: 0, INFO: 1, WARN: 2, ERROR: 3 };
+
+/**
+ * Global settings of the logging done by every AdvancedTransform: the minimum level that is printed,
+ * whether messages go to the console, and an optional JSONL file that gets one event per message.
+ * Filtering happens before a message is built, so messages given as functions cost nothing when
+ * they are dropped. Silent transforms only report warnings and errors.
+ * The initial level can be set with the CLAVA_TRANSFORMS_LOG_LEVEL environment variable.
+ */
+export class TransformLog {
+    private static threshold: LogLevel = TransformLog.parseLevel(process.env.CLAVA_TRANSFORMS_LOG_LEVEL);
+    private static consoleOutput: boolean = true;
+    private static sinkPath: string | undefined = undefined;
+    private static counts: Record<LogLevel, number> = { DEBUG: 0, INFO: 0, WARN: 0, ERROR: 0 };
+
+    public static setLevel(level: LogLevel): void {
+        TransformLog.threshold = level;
+    }
+
+    public static getLevel(): LogLevel {
+        return TransformLog.threshold;
+    }
+
+    public static setConsoleOutput(enabled: boolean): void {
+        TransformLog.consoleOutput = enabled;
+    }
+
+    public static isConsoleOutput(): boolean {
+        return TransformLog.consoleOutput;
+    }
+
+    /**
+     * Writes every message that passes the level filter to a JSONL file, or stops doing so if the path is undefined
+     */
+    public static setJsonlSink(path: string | undefined, truncate: boolean = true): void {
+        TransformLog.sinkPath = path;
+        if (path != undefined && truncate) {
+            fs.writeFileSync(path, "");
+        }
+    }
+
+    public static isEnabled(level: LogLevel, silent: boolean): boolean {
+        if (silent && LEVEL_ORDER[level] < LEVEL_ORDER.WARN) {
+            return false;
+        }
+        if (LEVEL_ORDER[level] < LEVEL_ORDER[TransformLog.threshold]) {
+            return false;
+        }
+        return TransformLog.consoleOutput || TransformLog.sinkPath != undefined;
+    }
+
+    public static write(event: LogEvent): void {
+        TransformLog.counts[event.level]++;
+        if (TransformLog.sinkPath != undefined) {
+            fs.appendFileSync(TransformLog.sinkPath, JSON.stringify(event) + "\n");
+        }
+    }
+
+    /**
+     * Number of messages of each level that passed the filter since the program started
+     */
+    public static getCounts(): Record<LogLevel, number> {
+        return { ...TransformLog.counts };
+    }
+
+    private static parseLevel(level: string | undefined): LogLevel {
+        const upper = level?.toUpperCase();
+        return upper != undefined && upper in LEVEL_ORDER ? upper as LogLevel : "INFO";
+    }
+}
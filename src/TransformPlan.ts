@@ -0,0 +1,47 @@
+/**
+ * A site where a transform could be applied, with its legality verdict and estimated benefit.
+ * For illegal candidates, reasons says why; for legal ones, it may list caveats.
+ */
+export type PlanCandidate = {
+    site: string,
+    function?: string,
+    legal: boolean,
+    reasons: string[],
+    benefit: Record<string, number>
+}
+
+/**
+ * Result of the analysis-only phase of a transform, computed without changing the AST.
+ * The estimated benefit is the sum of the benefits of the legal candidates.
+ */
+export type TransformPlan = {
+    transform: string,
+    candidates: PlanCandidate[],
+    legal: number,
+    rejected: number,
+    estimatedBenefit: Record<string, number>,
+    planTimeMs: number
+}
+
+export function buildPlan(transform: string, candidates: PlanCandidate[], startTime: number): TransformPlan {
+    const estimatedBenefit: Record<string, number> = {};
+    let legal = 0;
+
+    for (const candidate of candidates) {
+        if (!candidate.legal) {
+            continue;
+        }
+        legal++;
+        for (const [metric, value] of Object.entries(candidate.benefit)) {
+            estimatedBenefit[metric] = (estimatedBenefit[metric] ?? 0) + value;
+        }
+    }
+    return {
+        transform: transform,
+        candidates: candidates,
+        legal: legal,
+        rejected: candidates.length - legal,
+        estimatedBenefit: estimatedBenefit,
+        planTimeMs: Date.now() - startTime
+    };
+}
@@ -0,0 +1,105 @@
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { AdvancedTransform } from "./AdvancedTransform.js";
+import { InitializerBlobs } from "./InitializerBlobs.js";
+import { CallGraph } from "./program/CallGraph.js";
+
+/**
+ * Groups several transforms so that the AST is rebuilt only once, when the session is committed.
+ * While a session is open, every call to rebuildAfterTransform() is queued instead of reparsing
+ * the whole program. Sessions can be nested, in which case only the outermost commit rebuilds.
+ *
+ * Only transforms that do not rely on the AST being reparsed between them should share a session,
+ * e.g., several struct flattenings, but not an ArrayFlattener followed by constant folding.
+ */
+export class TransformSession extends AdvancedTransform {
+    private isOpen: boolean = false;
+    private requestedAtBegin: number = 0;
+    private rebuildsRequested: number = 0;
+
+    constructor(silent: boolean = false) {
+        super("TransformSession", silent);
+    }
+
+    public static isActive(): boolean {
+        return AdvancedTransform.sessionDepth > 0;
+    }
+
+    public begin(): void {
+        if (this.isOpen) {
+            this.logWarning("Session was already open, ignoring begin()");
+            return;
+        }
+        this.isOpen = true;
+        this.requestedAtBegin = AdvancedTransform.pendingRebuilds;
+        this.rebuildsRequested = 0;
+        AdvancedTransform.sessionDepth++;
+    }
+
+    /**
+     * Queues a rebuild for the end of the session, or rebuilds immediately if no session is open.
+     * Meant for scripts that would otherwise call Clava.rebuild() between transforms.
+     */
+    public requestRebuild(): boolean {
+        return this.rebuildAfterTransform();
+    }
+
+    /**
+     * Closes the session and, if it is the outermost one and any rebuild was requested, rebuilds the AST once.
+     * @returns false if the rebuild failed, true otherwise
+     */
+    public commit(): boolean {
+        if (!this.isOpen) {
+            this.logWarning("Session is not open, ignoring commit()");
+            return true;
+        }
+        this.isOpen = false;
+        AdvancedTransform.sessionDepth--;
+        this.rebuildsRequested = AdvancedTransform.pendingRebuilds - this.requestedAtBegin;
+
+        if (AdvancedTransform.sessionDepth > 0) {
+            this.log(`Nested session closed with ${this.rebuildsRequested} rebuild(s) left to the enclosing session`);
+            return true;
+        }
+        const pending = AdvancedTransform.pendingRebuilds;
+        AdvancedTransform.pendingRebuilds = 0;
+
+        if (pending === 0) {
+            this.log("Session committed, no rebuild was requested");
+            return true;
+        }
+        CallGraph.invalidate();
+        AdvancedTransform.rebuildCount++;
+        try {
+            Clava.rebuild();
+            InitializerBlobs.recompact();
+        } catch (e) {
+            this.logError(`Error rebuilding code when committing session with ${pending} pending rebuild(s)`);
+            console.log(e);
+            return false;
+        }
+        this.log(`Session committed with a single rebuild, avoided ${pending - 1} rebuild(s)`);
+        return true;
+    }
+
+    /**
+     * Runs the given transforms inside a session, committing it even if they throw.
+     */
+    public run(transforms: () => void): boolean {
+        this.begin();
+        try {
+            transforms();
+        } catch (e) {
+            this.commit();
+            throw e;
+        }
+        return this.commit();
+    }
+
+    public getRebuildsRequested(): number {
+        return this.isOpen ? AdvancedTransform.pendingRebuilds - this.requestedAtBegin : this.rebuildsRequested;
+    }
+
+    public getRebuildsAvoided(): number {
+        return Math.max(this.getRebuildsRequested() - 1, 0);
+    }
+}
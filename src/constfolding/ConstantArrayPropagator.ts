@@ -0,0 +1,140 @@
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { ArrayAccess, Expression, IntLiteral, Joinpoint, ParenExpr, Type, UnaryExprOrType, UnaryOp, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { InitializerBlobs } from "../InitializerBlobs.js";
+
+/**
+ * Replaces reads of constant array elements with literal subscripts (e.g., table[2][5]) by their value,
+ * taken from the elements of the InitializerBlobs registry rather than from the joinpoints of the
+ * initializer list, which is kept compacted.
+ */
+export class ConstantArrayPropagator extends AdvancedTransform {
+    constructor(silent: boolean = false) {
+        super("FoldingPropagation-ArrayProp", silent);
+    }
+
+    public doPass(region: Joinpoint): number {
+        return this.propagateReads(region).length;
+    }
+
+    /**
+     * @returns the expressions inserted in place of the element reads
+     */
+    public propagateReads(region: Joinpoint): Expression[] {
+        return this.findReads(region)
+            .map((access) => this.propagateRead(access))
+            .filter((expr): expr is Expression => expr != undefined);
+    }
+
+    /**
+     * Finds the outermost accesses to constant blobs, i.e., the ones that may be full element reads
+     */
+    public findReads(region: Joinpoint): ArrayAccess[] {
+        const names = new Set(InitializerBlobs.getBlobs().filter((blob) => blob.isConst).map((blob) => blob.key.split("::").pop()!));
+        if (names.size == 0) {
+            return [];
+        }
+        const reads: ArrayAccess[] = [];
+
+        for (const varref of Query.searchFrom(region, Varref)) {
+            if (!names.has(varref.name) || !(varref.parent instanceof ArrayAccess) || varref.parent.children[0].astId !== varref.astId) {
+                continue;
+            }
+            reads.push(this.getOutermostAccess(varref.parent));
+        }
+        return reads;
+    }
+
+    /**
+     * Replaces an element read by its value, if the array is a constant blob and every subscript is a literal.
+     * The value keeps the element type of the array, and operands of &, sizeof and decltype are left as they are.
+     * @returns the inserted expression, or undefined if the read was left as is
+     */
+    public propagateRead(access: ArrayAccess): Expression | undefined {
+        if (!this.isValueRead(access)) {
+            return undefined;
+        }
+        const subscripts: number[] = [];
+        let current: Expression = access;
+
+        while (current instanceof ArrayAccess) {
+            const subscript = current.children[1];
+            if (!(subscript instanceof IntLiteral)) {
+                return undefined;
+            }
+            subscripts.unshift(Number(subscript.value));
+            current = current.children[0] as Expression;
+        }
+        if (!(current instanceof Varref)) {
+            return undefined;
+        }
+
+        const decl = current.vardecl;
+        if (!(decl instanceof Vardecl)) {
+            return undefined;
+        }
+        const blob = InitializerBlobs.getBlob(decl);
+        if (blob == undefined || !blob.isConst) {
+            return undefined;
+        }
+        const value = InitializerBlobs.elementAt(blob, subscripts);
+        if (value == undefined) {
+            return undefined;
+        }
+        this.markDirty(access);
+        return access.replaceWith(this.buildLiteral(value, AstPredicates.baseTypeOf(decl.type))) as Expression;
+    }
+
+    /**
+     * Checks whether the value of the element is used, as opposed to its address (&table[1][2])
+     * or its type (sizeof(table[0][0]), or decltype(table[0][0]), whose expression is part of a type)
+     */
+    private isValueRead(access: ArrayAccess): boolean {
+        let parent = access.parent;
+        while (parent instanceof ParenExpr) {
+            parent = parent.parent;
+        }
+        if (parent instanceof UnaryOp && parent.kind == "addr_of") {
+            return false;
+        }
+        let current: Joinpoint | undefined = access.parent;
+        while (current instanceof Expression) {
+            if (current instanceof UnaryExprOrType) {
+                return false;
+            }
+            current = current.parent;
+        }
+        return !(current instanceof Type);
+    }
+
+    private getOutermostAccess(access: ArrayAccess): ArrayAccess {
+        let outermost = access;
+        while (outermost.parent instanceof ArrayAccess && outermost.parent.children[0].astId === outermost.astId) {
+            outermost = outermost.parent;
+        }
+        return outermost;
+    }
+
+    /**
+     * Builds the value as a literal of the element type, casting it unless the literal already has that type,
+     * e.g., (uint64_t)1 for elements that are shifted beyond 32 bits, or (float)0.5 to keep float arithmetic
+     */
+    private buildLiteral(value: string, elementType: Type): Expression {
+        const typeCode = elementType.desugarAll.code.trim();
+
+        // integers beyond 2^53 (e.g., 64-bit masks) and suffixed or octal values keep their exact spelling
+        const isInt = /^-?(0x[0-9a-fA-F]+|[1-9][0-9]*|0)$/.test(value);
+        if (isInt && Number.isSafeInteger(Number(value.replace("-", "")))) {
+            const literal = ClavaJoinPoints.integerLiteral(Number(value.replace("-", "")) * (value.startsWith("-") ? -1 : 1));
+            return typeCode == "int" ? literal : ClavaJoinPoints.cStyleCast(elementType, literal);
+        }
+        const isFloat = /^-?([0-9]+\.[0-9]*|\.[0-9]+)([eE][-+]?[0-9]+)?$/.test(value);
+        if (isFloat) {
+            const literal = ClavaJoinPoints.doubleLiteral(Number(value));
+            return typeCode == "double" ? literal : ClavaJoinPoints.cStyleCast(elementType, literal);
+        }
+        return ClavaJoinPoints.cStyleCast(elementType, ClavaJoinPoints.exprLiteral(value));
+    }
+}
@@ -40,7 +40,19 @@ export abstract class ConstantFolder extends AdvancedTransform {
 
     protected abstract getBinaryOps(): BinaryOp[];
 
-    private fold(op: BinaryOp): boolean {
+    public static isFoldable(op: BinaryOp): boolean {
+        return op.left instanceof Literal && op.right instanceof Literal;
+    }
+
+    public fold(op: BinaryOp): boolean {
+        return this.foldAndGetLiteral(op) != null;
+    }
+
+    /**
+     * Folds a binary operation whose operands are both literals.
+     * @returns the literal that replaced the operation in the AST, or null if it could not be folded
+     */
+    public foldAndGetLiteral(op: BinaryOp): Literal | null {
         const leftLit = op.left;
         const rightLit = op.right;
 
@@ -61,21 +73,22 @@ export abstract class ConstantFolder extends AdvancedTransform {
         }
 
         if (isNaN(n1) || isNaN(n2)) {
-            return false;
+            return null;
         }
 
         const isFloat = leftLit instanceof FloatLiteral || rightLit instanceof FloatLiteral;
 
         const newLit = this.doOperation(op.kind, n1, n2, isFloat);
 
-        if (newLit != null) {
-            op.replaceWith(newLit);
+        if (newLit == null) {
+            return null;
+        }
+        let inserted = op.replaceWith(newLit) as Literal;
 
-            if (newLit.parent instanceof ParenExpr && newLit.parent.children.length == 1) {
-                newLit.parent.replaceWith(newLit);
-            }
+        if (inserted.parent instanceof ParenExpr && inserted.parent.children.length == 1) {
+            inserted = inserted.parent.replaceWith(inserted) as Literal;
         }
-        return newLit != null;
+        return inserted;
     }
 
     private doOperation(kind: string, n1: number, n2: number, isFloat: boolean): Literal | null {
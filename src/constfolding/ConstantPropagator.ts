@@ -13,15 +13,24 @@ export class GlobalConstantPropagator extends AdvancedTransform implements Propa
     }
 
     public doPass(): number {
-        let replacements = 0;
+        return this.propagateGlobals().length;
+    }
+
+    /**
+     * Replaces the references to every constant global, or only to those in the given set of names.
+     * @returns the literals inserted in place of the references
+     */
+    public propagateGlobals(names?: Set<string>): Literal[] {
+        const inserted: Literal[] = [];
         const globalVars = this.getGlobalVars();
         const constGlobals = this.getConstantGlobals(globalVars);
 
         for (const [name, lit] of constGlobals.entries()) {
-            replacements += this.replaceRefs(name, lit);
+            if (names == undefined || names.has(name)) {
+                inserted.push(...this.replaceRefs(name, lit));
+            }
         }
-
-        return replacements;
+        return inserted;
     }
 
     private getGlobalVars(): Map<string, Literal> {
@@ -77,17 +86,14 @@ export class GlobalConstantPropagator extends AdvancedTransform implements Propa
         return true;
     }
 
-    private replaceRefs(name: string, literal: Literal): number {
+    private replaceRefs(name: string, literal: Literal): Literal[] {
         const toReplace: Varref[] = [];
 
         for (const varref of Query.search(Varref, { name: name })) {
             toReplace.push(varref);
         }
 
-        for (const varref of toReplace) {
-            varref.replaceWith(literal.copy());
-        }
-        return toReplace.length;
+        return toReplace.map((varref) => varref.replaceWith(literal.copy()) as Literal);
     }
 }
 
@@ -116,7 +122,7 @@ export class FunctionConstantPropagator extends AdvancedTransform implements Pro
         return replacements;
     }
 
-    private isSimpleAssignment(stmt: Statement): boolean {
+    public isSimpleAssignment(stmt: Statement): boolean {
         if (stmt instanceof DeclStmt) {
             const cond1 = stmt.children[0] instanceof Vardecl;
             const cond2 = stmt.children[0].children[0] instanceof Literal;
@@ -133,7 +139,7 @@ export class FunctionConstantPropagator extends AdvancedTransform implements Pro
         return false;
     }
 
-    private getPostAssignmentRegion(stmt: Statement, stmts: Statement[]): Statement[] {
+    public getPostAssignmentRegion(stmt: Statement, stmts: Statement[]): Statement[] {
         const region: Statement[] = [];
 
         let found = false;
@@ -149,23 +155,27 @@ export class FunctionConstantPropagator extends AdvancedTransform implements Pro
         return region;
     }
 
-    private propagateInRegion(region: Statement[], stmt: Statement): number {
-        let replacements = 0;
-        let varName: string = "";
-        let lit: Literal;
-
+    /**
+     * Returns the variable name and literal of a simple assignment, i.e., "int a = lit;" or "a = lit;"
+     */
+    public getAssignedConstant(stmt: Statement): [string, Literal] | undefined {
         if (stmt instanceof DeclStmt) {
-            varName = (stmt.children[0] as Vardecl).name;
-            lit = (stmt.children[0].children[0] as Literal);
+            return [(stmt.children[0] as Vardecl).name, stmt.children[0].children[0] as Literal];
         }
         else if (stmt instanceof ExprStmt) {
             const op = stmt.children[0] as BinaryOp;
-            varName = (op.left as Varref).name;
-            lit = op.right as Literal;
+            return [(op.left as Varref).name, op.right as Literal];
         }
-        else {
+        return undefined;
+    }
+
+    private propagateInRegion(region: Statement[], stmt: Statement): number {
+        let replacements = 0;
+        const assigned = this.getAssignedConstant(stmt);
+        if (assigned == undefined) {
             return replacements;
         }
+        const [varName, lit] = assigned;
 
         for (const postStmt of region) {
             const [replaced, canContinue] = this.propagate(postStmt, varName, lit);
@@ -178,7 +188,7 @@ export class FunctionConstantPropagator extends AdvancedTransform implements Pro
         return replacements;
     }
 
-    private propagate(stmt: Statement, varName: string, lit: Literal): [number, boolean] {
+    public propagate(stmt: Statement, varName: string, lit: Literal): [number, boolean] {
         if (stmt instanceof ExprStmt) {
             return this.propagateInExpr(stmt, varName, lit);
         }
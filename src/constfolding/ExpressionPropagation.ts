@@ -34,7 +34,7 @@ export class ExpressionPropagation extends AdvancedTransform {
             }
         }
         if (!atLeastOneMatch) {
-            this.log("No match for statement " + stmt.code.replace(/\n/g, " "));
+            this.logDebug(() => "No match for statement " + stmt.code.replace(/\n/g, " "));
         }
         return [replacements, canContinue];
     }
@@ -89,7 +89,7 @@ class ExprArithmeticAssignment implements ExpressionType {
                     toReplace.push(varref);
                     replacements++;
                 }
-                toReplace.forEach((varref) => { varref.replaceWith(lit); });
+                toReplace.forEach((varref) => { varref.replaceWith(lit.copy()); });
 
                 return [true, replacements, true];
             }
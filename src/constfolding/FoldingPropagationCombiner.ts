@@ -2,6 +2,9 @@ import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
 import { FunctionConstantPropagator, GlobalConstantPropagator } from "./ConstantPropagator.js";
 import { FunctionConstantFolder, GlobalConstantFolder } from "./ConstantFolder.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
+import { ChangeJournal } from "../ChangeJournal.js";
+import { WorklistFoldingPropagation } from "./WorklistFoldingPropagation.js";
+import { ConstantArrayPropagator } from "./ConstantArrayPropagator.js";
 
 export class FoldingPropagationCombiner extends AdvancedTransform {
     constructor(silent: boolean = false) {
@@ -14,9 +17,12 @@ export class FoldingPropagationCombiner extends AdvancedTransform {
 
         const globalPropagator = new GlobalConstantPropagator();
         const funPropagator = new FunctionConstantPropagator(fun);
+        const arrayPropagator = new ConstantArrayPropagator();
 
         let passes: number = 1;
         let keepGoing = true;
+        let globalChanges = 0;
+        let funChanges = 0;
 
         this.log(`Starting passes for function: ${fun.name}`);
         do {
@@ -26,9 +32,12 @@ export class FoldingPropagationCombiner extends AdvancedTransform {
 
             const globalProps = globalPropagator.doPass();
             const funProps = funPropagator.doPass();
-            const totalProps = globalProps + funProps;
+            const arrayProps = arrayPropagator.doPass(fun);
+            const totalProps = globalProps + funProps + arrayProps;
 
-            this.log(` --- Pass ${passes}: GF=${globalFolds}, FF=${funFolds}, GP=${globalProps}, FP=${funProps}`);
+            this.log(` --- Pass ${passes}: GF=${globalFolds}, FF=${funFolds}, GP=${globalProps}, FP=${funProps}, AP=${arrayProps}`);
+            globalChanges += globalFolds + globalProps;
+            funChanges += funFolds + funProps + arrayProps;
 
             passes++;
             const cond1 = totalFolds > 0 || totalProps > 0;
@@ -38,6 +47,46 @@ export class FoldingPropagationCombiner extends AdvancedTransform {
         }
         while (keepGoing);
 
+        this.recordChanges(fun, globalChanges, funChanges);
         return passes;
     }
+
+    /**
+     * Reaches the same fixed point as doPassesUntilStop(), but revisits only the expressions
+     * and statements affected by each fold or propagation instead of doing full passes.
+     * @returns the total number of folds and propagations
+     */
+    public doWorklistUntilStop(fun: FunctionJp): number {
+        const worklist = new WorklistFoldingPropagation(this.silent);
+        const stats = worklist.run(fun);
+
+        // global propagations can reach any function, the rest stays inside this one
+        this.recordChanges(fun, stats.globalProps, stats.folds + stats.funProps + stats.arrayProps);
+        return stats.folds + stats.globalProps + stats.funProps + stats.arrayProps;
+    }
+
+    /**
+     * Runs doWorklistUntilStop() only on the functions changed since a ChangeJournal mark, and on their callers.
+     * Meant for re-running folding and propagation after other passes, when most functions are untouched.
+     * @returns the total number of folds and propagations
+     */
+    public doWorklistOnChanged(funs: FunctionJp[], since: number): number {
+        const changed = ChangeJournal.filterDirty(funs, since);
+        this.log(`Revisiting ${changed.length} of ${funs.length} functions changed since mark ${since}`);
+
+        let total = 0;
+        for (const fun of changed) {
+            total += this.doWorklistUntilStop(fun);
+        }
+        return total;
+    }
+
+    private recordChanges(fun: FunctionJp, globalChanges: number, funChanges: number): void {
+        if (globalChanges > 0) {
+            this.markAllDirty();
+        }
+        else if (funChanges > 0) {
+            this.markDirty(fun);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ArrayAccess, BinaryOp, Expression, FunctionJp, Joinpoint, Literal, ParenExpr, Statement, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { ConstantArrayPropagator } from "./ConstantArrayPropagator.js";
+import { ConstantFolder, FunctionConstantFolder } from "./ConstantFolder.js";
+import { FunctionConstantPropagator, GlobalConstantPropagator } from "./ConstantPropagator.js";
+
+export type WorklistStats = {
+    folds: number;
+    globalProps: number;
+    funProps: number;
+    arrayProps: number;
+    elapsedMs: number;
+}
+
+/**
+ * Sparse alternative to FoldingPropagationCombiner.doPassesUntilStop(). It starts from every
+ * foldable operation and every constant assignment once, and afterwards only revisits what a change
+ * can affect: the parent of a folded expression, and the statements where a literal was propagated to.
+ * The folding and propagation rules are the same ones used by ConstantFolder and ConstantPropagator,
+ * plus reads of constant initializer blobs (ConstantArrayPropagator) once their subscripts are literals.
+ */
+export class WorklistFoldingPropagation extends AdvancedTransform {
+    private opQueue: BinaryOp[] = [];
+    private sourceQueue: Statement[] = [];
+    private globalQueue: Set<string> = new Set();
+    private readQueue: ArrayAccess[] = [];
+    private folded: Set<string> = new Set();
+    private arrayPropagator: ConstantArrayPropagator = new ConstantArrayPropagator(true);
+
+    constructor(silent: boolean = false) {
+        super("FoldingPropagation-Worklist", silent);
+    }
+
+    public run(fun: FunctionJp): WorklistStats {
+        const start = Date.now();
+        const stats: WorklistStats = { folds: 0, globalProps: 0, funProps: 0, arrayProps: 0, elapsedMs: 0 };
+
+        const folder = new FunctionConstantFolder(fun);
+        const globalPropagator = new GlobalConstantPropagator(true);
+        const funPropagator = new FunctionConstantPropagator(fun, true);
+
+        this.seed(fun, funPropagator);
+
+        while (this.opQueue.length > 0 || this.readQueue.length > 0 || this.sourceQueue.length > 0 || this.globalQueue.size > 0) {
+            while (this.opQueue.length > 0) {
+                const op = this.opQueue.pop()!;
+                if (this.folded.has(op.astId) || !ConstantFolder.isFoldable(op)) {
+                    continue;
+                }
+                const lit = folder.foldAndGetLiteral(op);
+
+                if (lit != null) {
+                    this.folded.add(op.astId);
+                    stats.folds++;
+                    this.afterLiteralInserted(lit, fun, funPropagator);
+                }
+            }
+
+            if (this.readQueue.length > 0) {
+                const access = this.readQueue.pop()!;
+                if (this.folded.has(access.astId)) {
+                    continue;
+                }
+                const lit = this.arrayPropagator.propagateRead(access);
+                if (lit != undefined) {
+                    this.folded.add(access.astId);
+                    stats.arrayProps++;
+                    this.afterLiteralInserted(lit, fun, funPropagator);
+                }
+                continue;
+            }
+
+            if (this.globalQueue.size > 0) {
+                const names = this.globalQueue;
+                this.globalQueue = new Set();
+
+                for (const lit of globalPropagator.propagateGlobals(names)) {
+                    stats.globalProps++;
+                    this.afterLiteralInserted(lit, fun, funPropagator);
+                }
+                continue;
+            }
+
+            if (this.sourceQueue.length > 0) {
+                const stmt = this.sourceQueue.shift()!;
+                stats.funProps += this.propagateFromSource(stmt, fun, funPropagator);
+            }
+        }
+
+        stats.elapsedMs = Date.now() - start;
+        const foldsPerSec = stats.elapsedMs > 0 ? Math.round(stats.folds * 1000 / stats.elapsedMs) : stats.folds;
+        this.log(`Function ${fun.name}: ${stats.folds} folds, ${stats.globalProps} global, ${stats.funProps} local and ${stats.arrayProps} array element propagations in ${stats.elapsedMs} ms (${foldsPerSec} folds/s)`);
+        return stats;
+    }
+
+    private seed(fun: FunctionJp, funPropagator: FunctionConstantPropagator): void {
+        this.opQueue = [];
+        this.sourceQueue = [];
+        this.globalQueue = new Set();
+        this.readQueue = this.arrayPropagator.findReads(fun);
+        this.folded = new Set();
+
+        for (const global of Query.search(Vardecl, { isGlobal: true })) {
+            if (!global.hasInit) {
+                continue;
+            }
+            if (global.children[0] instanceof Literal) {
+                this.globalQueue.add(global.name);
+            }
+            this.enqueueFoldableOps(global);
+        }
+        this.enqueueFoldableOps(fun);
+
+        for (const stmt of fun.body?.stmts ?? []) {
+            if (funPropagator.isSimpleAssignment(stmt)) {
+                this.sourceQueue.push(stmt);
+            }
+        }
+    }
+
+    private propagateFromSource(stmt: Statement, fun: FunctionJp, funPropagator: FunctionConstantPropagator): number {
+        const body = fun.body;
+        if (body == null || stmt.parent == undefined || stmt.parent.astId !== body.astId) {
+            return 0;
+        }
+        if (!funPropagator.isSimpleAssignment(stmt)) {
+            return 0;
+        }
+        const [varName, lit] = funPropagator.getAssignedConstant(stmt)!;
+        let replacements = 0;
+
+        for (const postStmt of funPropagator.getPostAssignmentRegion(stmt, body.stmts)) {
+            const [replaced, canContinue] = funPropagator.propagate(postStmt, varName, lit);
+
+            if (replaced > 0) {
+                replacements += replaced;
+                this.enqueueFoldableOps(postStmt);
+                if (funPropagator.isSimpleAssignment(postStmt)) {
+                    this.sourceQueue.push(postStmt);
+                }
+            }
+            if (!canContinue) {
+                break;
+            }
+        }
+        return replacements;
+    }
+
+    private afterLiteralInserted(lit: Expression, fun: FunctionJp, funPropagator: FunctionConstantPropagator): void {
+        const enclosingFun = lit.getAncestor("function") as FunctionJp | undefined;
+        if (enclosingFun != undefined && enclosingFun.astId !== fun.astId) {
+            return;
+        }
+
+        let parent = lit.parent;
+        while (parent instanceof ParenExpr) {
+            parent = parent.parent;
+        }
+        if (parent instanceof BinaryOp && ConstantFolder.isFoldable(parent)) {
+            this.opQueue.push(parent);
+            return;
+        }
+        if (parent instanceof ArrayAccess) {
+            this.readQueue.push(...this.arrayPropagator.findReads(parent));
+            return;
+        }
+
+        if (parent instanceof Vardecl && parent.isGlobal) {
+            this.globalQueue.add(parent.name);
+            return;
+        }
+        const stmt = lit.getAncestor("statement") as Statement | undefined;
+        if (stmt != undefined && fun.body != null && stmt.parent?.astId === fun.body.astId && funPropagator.isSimpleAssignment(stmt)) {
+            this.sourceQueue.push(stmt);
+        }
+    }
+
+    private enqueueFoldableOps(jp: Joinpoint): void {
+        for (const op of Query.searchFrom(jp, BinaryOp)) {
+            if (ConstantFolder.isFoldable(op)) {
+                this.opQueue.push(op);
+            }
+        }
+    }
+}
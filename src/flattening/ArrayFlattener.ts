@@ -3,6 +3,8 @@ import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { PlanCandidate, TransformPlan } from "../TransformPlan.js";
+import { InitializerBlobs } from "../InitializerBlobs.js";
 
 export class ArrayFlattener extends AdvancedTransform {
     constructor(silent: boolean = false) {
@@ -52,6 +54,95 @@ export class ArrayFlattener extends AdvancedTransform {
         return cnt;
     }
 
+    /**
+     * Flattens only the arrays declared inside a function, leaving its parameters (and therefore its signature)
+     * untouched. Arrays that are used whole (e.g., passed to a callee that expects int (*)[C]) are skipped too,
+     * since the callee may be in another translation unit, so that the result only depends on the function itself.
+     */
+    public flattenLocalsInFunction(fun: FunctionJp): number {
+        const usedWhole = new Set<string>();
+        for (const varref of Query.searchFrom(fun, Varref)) {
+            if (!(varref.parent instanceof ArrayAccess) || varref.parent.children[0].astId !== varref.astId) {
+                usedWhole.add(varref.name);
+            }
+        }
+
+        let cnt = 0;
+        for (const decl of this.findDecls(fun, Vardecl)) {
+            if (decl instanceof Param) {
+                continue;
+            }
+            if (usedWhole.has(decl.name)) {
+                this.logDebug(() => `Array ${decl.name} in function ${fun.name} is used without subscripts, not flattening it`);
+                continue;
+            }
+            if (this.flattenArray(decl, fun)) {
+                cnt++;
+            }
+        }
+        return cnt;
+    }
+
+    /**
+     * Analysis-only counterpart of flattenAll(): lists every 2D and 3D array, whether it can be flattened,
+     * and how many accesses would be rewritten, without changing the AST.
+     */
+    public planFlattenAll(): TransformPlan {
+        const start = Date.now();
+        const candidates: PlanCandidate[] = [];
+
+        for (const fun of Query.search(FunctionJp, { isImplementation: true })) {
+            const accesses = this.countArrayAccesses(fun);
+            for (const decl of Query.searchFrom(fun, Vardecl)) {
+                const candidate = this.planArray(decl, accesses, fun.name);
+                if (candidate != undefined) {
+                    candidates.push(candidate);
+                }
+            }
+        }
+        const globalAccesses = this.countArrayAccesses(Clava.getProgram());
+        for (const decl of Query.search(Vardecl, { isGlobal: true })) {
+            const candidate = this.planArray(decl, globalAccesses);
+            if (candidate != undefined) {
+                candidates.push(candidate);
+            }
+        }
+        return this.makePlan(candidates, start);
+    }
+
+    private planArray(decl: Vardecl, accesses: Map<string, number>, funName?: string): PlanCandidate | undefined {
+        if (!decl.type.isArray || decl.type.arrayDims.length < 2) {
+            return undefined;
+        }
+        const candidate: PlanCandidate = {
+            site: `${decl.name} at ${decl.location}`,
+            function: funName,
+            legal: true,
+            reasons: [],
+            benefit: { arraysFlattened: 1, accessesRewritten: accesses.get(decl.name) ?? 0 }
+        };
+        const flattenable = decl.type.arrayDims.length > 3 ? "Array with more than 3 dimensions not supported" : this.getFlattenableDims(decl);
+
+        if (typeof flattenable === "string") {
+            candidate.legal = false;
+            candidate.reasons.push(flattenable);
+        }
+        else if (decl.children.length > 0 && !(decl.children[0] instanceof InitList)) {
+            candidate.reasons.push("Initializer is not an initializer list, and would be removed or kept as is");
+        }
+        return candidate;
+    }
+
+    private countArrayAccesses(region: Joinpoint): Map<string, number> {
+        const accesses = new Map<string, number>();
+        for (const varref of Query.searchFrom(region, Varref)) {
+            if (varref.parent instanceof ArrayAccess) {
+                accesses.set(varref.name, (accesses.get(varref.name) ?? 0) + 1);
+            }
+        }
+        return accesses;
+    }
+
     public flattenAllGlobals(): number {
         const arrays: Vardecl[] = [];
 
@@ -113,6 +204,12 @@ export class ArrayFlattener extends AdvancedTransform {
                 }
             }
         }
+        if (region instanceof FunctionJp) {
+            this.markDirty(region);
+        }
+        else {
+            this.markAllDirty();
+        }
         return true;
     }
 
@@ -133,9 +230,11 @@ export class ArrayFlattener extends AdvancedTransform {
         return decls;
     }
 
-    private flattenArrayDecl(decl: Vardecl): [number, number, number] {
-        const type = decl.type;
-        const dims = type.arrayDims;
+    /**
+     * Returns the [depth, rows, cols] of a 2D (depth = -1) or 3D array, or the reason why it cannot be flattened.
+     */
+    private getFlattenableDims(decl: Vardecl): [number, number, number] | string {
+        const dims = decl.type.arrayDims;
 
         const depth = dims.length == 3 ? dims[0] : -1;
         const rows = dims.length == 3 ? dims[1] : dims[0];
@@ -143,17 +242,25 @@ export class ArrayFlattener extends AdvancedTransform {
 
         if (rows == -1 || cols == -1 || rows == undefined || cols == undefined || Number.isNaN(rows) || Number.isNaN(cols)) {
             if (dims.length == 2) {
-                this.logWarning(`2D array with dimensions [${rows}][${cols}] not supported`);
+                return `2D array with dimensions [${rows}][${cols}] not supported`;
             }
-            else {
-                this.logWarning(`3D array with dimensions [${depth}][${rows}][${cols}] not supported`);
-            }
-            return [-1, -1, -1];
+            return `3D array with dimensions [${depth}][${rows}][${cols}] not supported`;
         }
         if (depth == -1 && dims.length == 3) {
-            this.logWarning(`3D array with dimensions [${depth}][${rows}][${cols}] not supported`);
+            return `3D array with dimensions [${depth}][${rows}][${cols}] not supported`;
+        }
+        return [depth, rows, cols];
+    }
+
+    private flattenArrayDecl(decl: Vardecl): [number, number, number] {
+        const type = decl.type;
+        const flattenable = this.getFlattenableDims(decl);
+
+        if (typeof flattenable === "string") {
+            this.logWarning(flattenable);
             return [-1, -1, -1];
         }
+        const [depth, rows, cols] = flattenable;
         const simpleType = this.simpleType(type);
 
         const fullSize: number[] = [rows * cols * (depth == -1 ? 1 : depth)];
@@ -167,7 +274,11 @@ export class ArrayFlattener extends AdvancedTransform {
             const newDecl = ClavaJoinPoints.varDeclNoInit(decl.name, newTypeJp);
 
             if (decl.children.length > 0) {
-                if (decl.children[0] instanceof InitList) {
+                if (InitializerBlobs.isBlob(decl)) {
+                    // reshaped from the parsed elements, without going through the joinpoints of the list
+                    newDecl.setInit(InitializerBlobs.reshape(decl, fullSize));
+                }
+                else if (decl.children[0] instanceof InitList) {
                     const init = this.getInitList(decl.children[0]);
                     newDecl.setInit(init);
                 }
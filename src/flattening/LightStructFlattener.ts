@@ -681,7 +681,7 @@ export class LightStructFlattener extends StructFlatteningAlgorithm {
             }
         }
         else {
-            this.log(`    Detected malloc for array of structs for variable ${lhs.code}`);
+            this.log(() => `    Detected malloc for array of structs for variable ${lhs.code}`);
         }
 
         let structSize = 0;
@@ -845,7 +845,7 @@ export class LightStructFlattener extends StructFlatteningAlgorithm {
         });
         parentStmt.detach();
 
-        this.log(`  Flattened memcpy call args {${srcArg.code}, ${destArg.code}}`);
+        this.log(() => `  Flattened memcpy call args {${srcArg.code}, ${destArg.code}}`);
         changes += 1;
         return changes;
     }
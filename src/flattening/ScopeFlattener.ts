@@ -1,14 +1,16 @@
-import { DeclStmt, FunctionJp, Scope, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import { DeclStmt, FunctionJp, Scope, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
+import { DefUseIndex } from "../function/DefUseIndex.js";
 
 export class ScopeFlattener extends AdvancedTransform {
     constructor(silent: boolean = false) {
         super("ScopeFlattener", silent);
     }
 
-    public flattenScope(scope: Scope, usePrefix: boolean = true, prefix: string = "_scope"): number {
+    public flattenScope(scope: Scope, usePrefix: boolean = true, prefix: string = "_scope", index?: DefUseIndex): number {
+        const defUse = index ?? new DefUseIndex(scope);
         let n = 0;
         const innerScopes: Scope[] = [];
         for (const child of scope.children) {
@@ -20,7 +22,7 @@ export class ScopeFlattener extends AdvancedTransform {
             }
         }
         innerScopes.forEach(innerScope => {
-            n += this.flattenScope(innerScope, usePrefix, IdGenerator.next(prefix));
+            n += this.flattenScope(innerScope, usePrefix, IdGenerator.next(prefix), defUse);
         });
 
         if (usePrefix) {
@@ -32,14 +34,10 @@ export class ScopeFlattener extends AdvancedTransform {
             }
 
             for (const decl of decls) {
-                const newName = `${prefix}_${decl.name}`;
-
-                for (const ref of Query.searchFrom(scope, Varref, { name: decl.name })) {
-                    ref.name = newName
-                }
-                decl.name = newName;
+                defUse.rename(decl, `${prefix}_${decl.name}`, scope);
             }
         }
+        this.markDirty(scope);
         for (const child of scope.children) {
             scope.insertBefore(child);
         }
@@ -52,12 +50,14 @@ export class ScopeFlattener extends AdvancedTransform {
         if (fun.body === undefined) {
             return n;
         }
-        let allScopes = Query.searchFrom(fun.body, Scope).get().filter(scope => this.isRedundant(scope));
-        this.sortScopes(allScopes);
+        const allScopes = this.sortScopesInnermostFirst(fun.body, Query.searchFrom(fun.body, Scope).get())
+            .filter(scope => this.isRedundant(scope));
 
+        // renames keep the index consistent, and moving statements out of a scope does not change any def-use pair
+        const index = new DefUseIndex(fun);
         for (const scope of allScopes) {
             if (scope.parent !== undefined) {
-                n += this.flattenScope(scope, usePrefix, IdGenerator.next(prefix));
+                n += this.flattenScope(scope, usePrefix, IdGenerator.next(prefix), index);
             }
         }
         return n;
@@ -67,24 +67,25 @@ export class ScopeFlattener extends AdvancedTransform {
         return scope.joinPointType !== "body";
     }
 
-    private sortScopes(scopes: Scope[]): void {
-        scopes.sort((s1, s2) => {
-            // if s1 is a descendant of s2, s1 > s2, return 1
-            const cond1 = Query.searchFrom(s1, Scope).get().some(sc => {
-                return sc.line === s2.line;
-            });
-            if (cond1) {
-                return 1;
-            }
-            // if s2 is a descendant of s1, s1 < s2, return -1
-            const cond2 = Query.searchFrom(s2, Scope).get().some(sc => {
-                return sc.line === s1.line;
-            });
-            if (cond2) {
-                return -1;
+    /**
+     * Buckets the scopes by nesting depth and returns them deepest first. The scopes are expected
+     * in pre-order (as returned by Query), so the depth of a scope's enclosing scope is always known
+     * by the time the scope itself is visited.
+     */
+    private sortScopesInnermostFirst(body: Scope, scopes: Scope[]): Scope[] {
+        const depths = new Map<string, number>([[body.astId, 0]]);
+        const buckets: Scope[][] = [];
+
+        for (const scope of scopes) {
+            const enclosing = scope.getAncestor("scope") as Scope | undefined;
+            const depth = (enclosing != undefined ? depths.get(enclosing.astId) ?? 0 : 0) + 1;
+            depths.set(scope.astId, depth);
+
+            if (buckets[depth] == undefined) {
+                buckets[depth] = [];
             }
-            // otherwise, return 0
-            return 0;
-        });
+            buckets[depth].push(scope);
+        }
+        return buckets.reverse().flat();
     }
 }
\ No newline at end of file
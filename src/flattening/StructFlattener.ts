@@ -1,8 +1,11 @@
-import { Call, Class, FileJp, FunctionJp, Joinpoint, Struct, TypedefDecl } from "@specs-feup/clava/api/Joinpoints.js";
+import { Call, Class, FileJp, FunctionJp, Joinpoint, MemberAccess, Struct, TagType, Type, TypedefDecl, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import { LegacyStructFlattener } from "./legacy/LegacyStructFlattener.js";
 import { StructFlatteningAlgorithm } from "./StructFlatteningAlgorithm.js";
+import { CallGraph } from "../program/CallGraph.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { PlanCandidate, TransformPlan } from "../TransformPlan.js";
 
 export class StructFlattener extends AdvancedTransform {
     private algorithm: StructFlatteningAlgorithm;
@@ -32,11 +35,19 @@ export class StructFlattener extends AdvancedTransform {
         });
 
         const decompNames: string[] = [];
+        const returnedBy = this.getReturningFunctions(funs);
 
         totalStructs.forEach(([name, struct]) => {
+            const blockers = this.getFlatteningBlockers(name, struct, returnedBy);
+            if (blockers.length > 0) {
+                this.logWarning(`Not flattening struct ${name}: ${blockers.join("; ")}`);
+                return;
+            }
             this.log(`Flattening struct ${name}`);
 
             this.algorithm.flatten(struct.fields, name, funs);
+            CallGraph.invalidate();
+            this.markAllDirty();
             decompNames.push(name);
             this.log(`Done flattening struct ${name}`);
         });
@@ -49,31 +60,127 @@ export class StructFlattener extends AdvancedTransform {
 
     public flattenByName(name: string, startingPoint?: FunctionJp): boolean {
         const funs = this.getFunctionChain(startingPoint);
+        const returnedBy = this.getReturningFunctions(funs);
         const structs = [
             ...this.findAllStructs(),
             ...this.findAllStructlikeClasses()
         ];
+        let flattened = false;
         structs.forEach((elem) => {
             const elemName = elem[0];
             const elemStruct = elem[1];
 
             if (elemName === name) {
-
+                const blockers = this.getFlatteningBlockers(name, elemStruct, returnedBy);
+                if (blockers.length > 0) {
+                    this.logWarning(`Not flattening struct ${name}: ${blockers.join("; ")}`);
+                    return;
+                }
                 this.algorithm.flatten(elemStruct.fields, name, funs);
+                CallGraph.invalidate();
+                this.markAllDirty();
+                flattened = true;
             }
         });
+        if (!flattened) {
+            return false;
+        }
         return this.rebuildAfterTransform();
     }
 
     public flattenStruct(struct: Struct, startingPoint?: FunctionJp): boolean {
         const name = this.getStructName(struct);
         const funs = this.getFunctionChain(startingPoint);
+        const blockers = this.getFlatteningBlockers(name, struct, this.getReturningFunctions(funs));
+        if (blockers.length > 0) {
+            this.logWarning(`Not flattening struct ${name}: ${blockers.join("; ")}`);
+            return false;
+        }
         this.algorithm.flatten(struct.fields, name, funs);
+        CallGraph.invalidate();
+        this.markAllDirty();
 
         return this.rebuildAfterTransform();
     }
 
+    /**
+     * Analysis-only counterpart of flattenAll(): lists every struct, whether it can be flattened, and
+     * how many declarations and member accesses would be rewritten, without changing the AST.
+     */
+    public planFlattenAll(startingPoint?: FunctionJp): TransformPlan {
+        const start = Date.now();
+        const funs = this.getFunctionChain(startingPoint);
+        const decls = new Map<string, number>();
+        const accesses = new Map<string, number>();
+        const returnedBy = this.getReturningFunctions(funs);
+        const increment = (map: Map<string, number>, type: Type) => {
+            const name = this.simpleType(type);
+            map.set(name, (map.get(name) ?? 0) + 1);
+        };
+
+        for (const decl of Query.search(Vardecl, (d) => d.isGlobal)) {
+            increment(decls, decl.type);
+        }
+        for (const fun of funs) {
+            Query.searchFrom(fun, Vardecl).get().forEach((decl) => increment(decls, decl.type));
+            Query.searchFrom(fun, MemberAccess).get().forEach((access) => increment(accesses, access.base.type));
+        }
+
+        const candidates: PlanCandidate[] = [];
+        for (const [name, struct] of [...this.findAllStructs(), ...this.findAllStructlikeClasses()]) {
+            const reasons = this.getFlatteningBlockers(name, struct, returnedBy);
+            const legal = reasons.length == 0;
+            if (struct.fields.some((field) => this.isStructType(field.type))) {
+                reasons.push("Has struct fields, which are kept as struct variables");
+            }
+            candidates.push({
+                site: `struct ${name}`,
+                legal: legal,
+                reasons: reasons,
+                benefit: {
+                    structsFlattened: 1,
+                    fieldsExpanded: struct.fields.length,
+                    declsRewritten: decls.get(name) ?? 0,
+                    accessesRewritten: accesses.get(name) ?? 0
+                }
+            });
+        }
+        return this.makePlan(candidates, start);
+    }
+
     // -----------------------------------------------------------------------
+    private isStructType(type: Type): boolean {
+        const base = AstPredicates.baseTypeOf(type).desugarAll;
+        return base instanceof TagType && base.decl instanceof Struct;
+    }
+
+    /**
+     * Names of the functions that return each type (by value or through one pointer level), using the
+     * same type matching as the flattening algorithms, which leave return values as they are
+     */
+    private getReturningFunctions(funs: FunctionJp[]): Map<string, string[]> {
+        const returnedBy = new Map<string, string[]>();
+        for (const fun of funs) {
+            const returned = this.simpleType(fun.returnType);
+            returnedBy.set(returned, [...(returnedBy.get(returned) ?? []), fun.name]);
+        }
+        return returnedBy;
+    }
+
+    /**
+     * Reasons why a struct is not flattened, shared by the flattening methods and planFlattenAll()
+     */
+    private getFlatteningBlockers(name: string, struct: Struct | Class, returnedBy: Map<string, string[]>): string[] {
+        const reasons: string[] = [];
+        if (struct.fields.length == 0) {
+            reasons.push("Struct has no fields");
+        }
+        for (const funName of returnedBy.get(name) ?? []) {
+            reasons.push(`Returned by ${funName}(), and return values are not flattened`);
+        }
+        return reasons;
+    }
+
     private findAllStructs(): [string, Struct][] {
         const structs: [string, Struct][] = [];
 
@@ -4,6 +4,7 @@ import Query from "@specs-feup/lara/api/weaver/Query.js";
 import NormalizeToSubset from "@specs-feup/clava/api/clava/opt/NormalizeToSubset.js";
 import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
 import { Inliner } from "./Inliner.js";
+import { CallGraph } from "../program/CallGraph.js";
 
 export class AllocatorInliner extends Inliner {
     constructor(silent: boolean = false) {
@@ -27,7 +28,7 @@ export class AllocatorInliner extends Inliner {
                 continue;
             }
             funs.push(fun);
-            this.log(`Found allocator function ${fun.name} with return ${assignedPointer.type.code} ${assignedPointer.name}`);
+            this.log(() => `Found allocator function ${fun.name} with return ${assignedPointer.type.code} ${assignedPointer.name}`);
         }
         return funs;
     }
@@ -120,6 +121,7 @@ export class AllocatorInliner extends Inliner {
 
         parentStmt.detach();
         clone.detach();
+        CallGraph.invalidate();
         return true;
     }
 
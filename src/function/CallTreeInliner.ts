@@ -4,6 +4,9 @@ import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { Inliner } from "./Inliner.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { CallGraph } from "../program/CallGraph.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { PlanCandidate, TransformPlan } from "../TransformPlan.js";
 
 export class CallTreeInliner extends AdvancedTransform {
     constructor(silent: boolean = false) {
@@ -59,6 +62,177 @@ export class CallTreeInliner extends AdvancedTransform {
         return this.rebuildAfterTransform();
     }
 
+    /**
+     * Same result as inlineCallTree(), but the call tree is computed only once and inlined bottom-up:
+     * every function has its callees inlined before it is itself inlined into its callers,
+     * so no callee body is cloned more than once per call site. Unlike inlineCallTree(), the
+     * intermediate functions of the tree end up with their own callees inlined as well.
+     * Calls inside recursive cycles are left as they are.
+     */
+    public inlineCallTreeBottomUp(topLevelFunction: FunctionJp, removeInlined: boolean = false, prefix: string = "_i"): boolean {
+        const callGraph = CallGraph.get();
+        const topName = topLevelFunction.name;
+        const components = callGraph.getStronglyConnectedComponents(topLevelFunction);
+        const levels = this.computeLevels(callGraph, components);
+
+        // call sites are collected before anything is inlined, as the call graph is invalidated by every inlining
+        const sitesByName = new Map<string, Call[]>();
+        for (const component of components) {
+            for (const name of component) {
+                sitesByName.set(name, [...callGraph.getCallSites(name)]);
+            }
+        }
+        const recursive = new Set(callGraph.getRecursiveComponents(topLevelFunction).flat());
+        recursive.forEach((name) => this.logWarning(`  Function ${name} is part of a recursive cycle, its calls will not be inlined`));
+
+        const inliner = new Inliner(true);
+        const inlinedFuns: Set<FunctionJp> = new Set();
+        const failedCallees: Set<string> = new Set();
+        let totalInlined = 0;
+        this.log(`Starting bottom-up call tree inlining from function ${topName} (${levels.length} levels)`);
+
+        levels.forEach((level, levelIdx) => {
+            const start = Date.now();
+            let inlinedThisLevel = 0;
+            let iterations = 0;
+
+            for (const name of level) {
+                if (recursive.has(name)) {
+                    continue;
+                }
+                const queue: Call[] = sitesByName.get(name)!.filter((call) => this.isInlinable(call, recursive, failedCallees));
+
+                while (queue.length > 0) {
+                    const call = queue.shift()!;
+                    const callee = call.function;
+                    iterations++;
+
+                    if (inliner.inline(call, prefix)) {
+                        inlinedThisLevel++;
+                        inlinedFuns.add(callee);
+                        this.log(`  Inlined call to function ${callee.name}() into ${name}()`);
+
+                        // callees were already flattened, so only calls they could not inline can show up here
+                        for (const stmt of inliner.getLastInlinedStatements()) {
+                            const exposed = Query.searchFromInclusive(stmt, Call).get();
+                            queue.push(...exposed.filter((c) => this.isInlinable(c, recursive, failedCallees)));
+                        }
+                    }
+                    else {
+                        failedCallees.add(callee.name);
+                        this.logWarning(`  Failed to inline call to function ${callee.name} at ${call.location}`);
+                    }
+                }
+            }
+            totalInlined += inlinedThisLevel;
+            this.log(`Level ${levelIdx} (${level.length} functions) completed in ${Date.now() - start} ms: ${iterations} iterations, ${inlinedThisLevel} clones inlined.`);
+        });
+        this.log(`Inlined a total of ${totalInlined} function calls in the call tree of function ${topName}.`);
+
+        if (removeInlined) {
+            this.removeInlinedFunctions(topLevelFunction, inlinedFuns);
+        }
+        this.sanitizeInlinedRegion(topLevelFunction);
+        return this.rebuildAfterTransform();
+    }
+
+    /**
+     * Analysis-only counterpart of inlineCallTreeBottomUp(): lists every call site in the call tree,
+     * whether it can be inlined, and how many statements inlining it would clone (including the callees
+     * of the callee, which are inlined into it first), without changing the AST.
+     */
+    public planInlineCallTree(topLevelFunction: FunctionJp): TransformPlan {
+        const start = Date.now();
+        const callGraph = CallGraph.get();
+        const recursive = new Set(callGraph.getRecursiveComponents(topLevelFunction).flat());
+        const candidates: PlanCandidate[] = [];
+        // statements of a function after its own callees are inlined, filled callees first
+        const inlinedSizes = new Map<string, number>();
+
+        for (const component of callGraph.getStronglyConnectedComponents(topLevelFunction)) {
+            for (const name of component) {
+                const fun = callGraph.getFunction(name)!;
+                let size = Query.searchFrom(fun.body, Statement).get().length;
+
+                for (const call of callGraph.getCallSites(name)) {
+                    const callee = call.function;
+                    if (callee == undefined || !callee.isImplementation) {
+                        continue;
+                    }
+                    const reasons = this.getInlineBlockers(name, callee, recursive);
+                    const cloned = inlinedSizes.get(callee.name) ?? 0;
+                    if (reasons.length == 0) {
+                        size += cloned;
+                    }
+                    candidates.push({
+                        site: `${callee.name}() at ${call.location}`,
+                        function: name,
+                        legal: reasons.length == 0,
+                        reasons: reasons,
+                        benefit: { callsRemoved: 1, statementsCloned: cloned }
+                    });
+                }
+                inlinedSizes.set(name, size);
+            }
+        }
+        return this.makePlan(candidates, start);
+    }
+
+    /**
+     * Reasons why a call from the given caller to the given callee would not be inlined, if any
+     * @param recursive names of the functions in recursive cycles, as returned by CallGraph.getRecursiveComponents()
+     */
+    public getInlineBlockers(callerName: string, callee: FunctionJp, recursive: Set<string>): string[] {
+        const reasons: string[] = [];
+        if (recursive.has(callerName)) {
+            reasons.push(`Caller ${callerName}() is part of a recursive cycle`);
+        }
+        if (recursive.has(callee.name)) {
+            reasons.push(`Callee ${callee.name}() is part of a recursive cycle`);
+        }
+        if (!AstPredicates.isVoidType(callee.returnType)) {
+            reasons.push(`Callee ${callee.name}() is not void`);
+        }
+        return reasons;
+    }
+
+    private isInlinable(call: Call, recursive: Set<string>, failedCallees: Set<string>): boolean {
+        const callee = call.function;
+        if (callee == undefined || !callee.isImplementation) {
+            return false;
+        }
+        return !recursive.has(callee.name) && !failedCallees.has(callee.name);
+    }
+
+    /**
+     * Groups the functions of the call tree by height, i.e., leaves are in level 0, and every
+     * other function is one level above its highest callee. Components are expected in reverse
+     * topological order, as returned by CallGraph.getStronglyConnectedComponents().
+     */
+    private computeLevels(callGraph: CallGraph, components: string[][]): string[][] {
+        const heights = new Map<string, number>();
+        const levels: string[][] = [];
+
+        for (const component of components) {
+            let height = 0;
+            for (const name of component) {
+                for (const callee of callGraph.getCallees(name)) {
+                    if (!component.includes(callee.name) && heights.has(callee.name)) {
+                        height = Math.max(height, heights.get(callee.name)! + 1);
+                    }
+                }
+            }
+            for (const name of component) {
+                heights.set(name, height);
+                if (levels[height] == undefined) {
+                    levels[height] = [];
+                }
+                levels[height].push(name);
+            }
+        }
+        return levels;
+    }
+
     public revertGlobalsToParams(fun: FunctionJp): boolean {
         // remove assignments to global variables at start and end of function
         const stmtsToRemove = [];
@@ -81,7 +255,7 @@ export class CallTreeInliner extends AdvancedTransform {
             const param = globalParams[i];
             if (param.type instanceof BuiltinType || param.type instanceof QualType || param.type instanceof TypedefType) {
                 const newType = ClavaJoinPoints.pointer(param.type);
-                this.log(`  Changing parameter ${param.name} type from ${param.type.code} to ${newType.code}`);
+                this.log(() => `  Changing parameter ${param.name} type from ${param.type.code} to ${newType.code}`);
                 param.setType(newType);
                 modifiedIdx.push(i);
             }
@@ -109,9 +283,9 @@ export class CallTreeInliner extends AdvancedTransform {
                 const parenthesis = ClavaJoinPoints.parenthesis(arg);
                 const addrOf = ClavaJoinPoints.unaryOp("&", parenthesis);
                 call.setArg(i, addrOf);
-                this.log(`    Updated argument ${addrOf.code} (${i}) in call at ${call.location}`);
+                this.logDebug(() => `    Updated argument ${addrOf.code} (${i}) in call at ${call.location}`);
             }
-            this.log(`  Updated call to function ${call.function.name} at ${call.location}`);
+            this.log(() => `  Updated call to function ${call.function.name} at ${call.location}`);
         }
         // update function declarations
         for (const funDecl of Query.search(FunctionJp, (f) => f.name === fun.name && !f.isImplementation).get()) {
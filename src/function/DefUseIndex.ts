@@ -0,0 +1,192 @@
+import { BinaryOp, Expression, Joinpoint, ParenExpr, UnaryOp, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+
+export type VarAccess = "read" | "write" | "readwrite";
+
+/**
+ * Def-use index of a function: for every variable declaration (or name) it keeps its references,
+ * and for every reference its declaration and whether it is read and/or written.
+ * It is built with a single AST walk the first time it is queried, and stays consistent as long as
+ * references are renamed or replaced through it. Any other change to the function makes it stale,
+ * so it is meant to be created and shared within a single transformation step.
+ */
+export class DefUseIndex {
+    private root: Joinpoint;
+    private isBuilt: boolean = false;
+    private refsByName: Map<string, Varref[]> = new Map();
+    private refsByDecl: Map<string, Varref[]> = new Map();
+    private declByRef: Map<string, Vardecl> = new Map();
+    private declsByName: Map<string, Vardecl[]> = new Map();
+
+    constructor(root: Joinpoint) {
+        this.root = root;
+    }
+
+    public getRefs(name: string): Varref[] {
+        this.ensureBuilt();
+        return this.refsByName.get(name) ?? [];
+    }
+
+    /**
+     * Returns the references to a declaration or, if none are linked to it, the references to its name
+     * that are unresolved or linked to a local declaration of another function. The latter happens in
+     * outlined or cloned code, whose references still point to the declarations of the original function.
+     * References to globals are never taken by name, as they may be shadowed by an unused local.
+     */
+    public getRefsOf(decl: Vardecl): Varref[] {
+        this.ensureBuilt();
+        const linked = this.refsByDecl.get(decl.astId);
+        if (linked != undefined && linked.length > 0) {
+            return linked;
+        }
+        return this.getRefs(decl.name).filter((ref) => {
+            const refDecl = this.declByRef.get(ref.astId);
+            return refDecl == undefined
+                || (!refDecl.isGlobal && !this.getDecls(refDecl.name).some((d) => d.astId === refDecl.astId));
+        });
+    }
+
+    public getDecl(ref: Varref): Vardecl | undefined {
+        this.ensureBuilt();
+        return this.declByRef.get(ref.astId);
+    }
+
+    public getDecls(name: string): Vardecl[] {
+        this.ensureBuilt();
+        return this.declsByName.get(name) ?? [];
+    }
+
+    public getAccess(ref: Varref): VarAccess {
+        return ref.use as VarAccess;
+    }
+
+    public getWrites(decl: Vardecl): Varref[] {
+        return this.getRefsOf(decl).filter((ref) => this.getAccess(ref) !== "read");
+    }
+
+    /**
+     * Checks whether a variable is the target of an assignment (simple or compound) or of an increment/decrement,
+     * i.e., whether the variable itself is changed, as opposed to the memory it may point to.
+     */
+    public isReassigned(decl: Vardecl): boolean {
+        return this.getRefsOf(decl).some((ref) => DefUseIndex.isReassignment(ref));
+    }
+
+    public static isReassignment(ref: Varref): boolean {
+        let child: Joinpoint = ref;
+        let parent = ref.parent;
+        while (parent instanceof ParenExpr) {
+            child = parent;
+            parent = parent.parent;
+        }
+        if (parent instanceof BinaryOp) {
+            return parent.isAssignment && parent.left.astId === child.astId;
+        }
+        if (parent instanceof UnaryOp) {
+            return ["++", "--"].includes(parent.operator);
+        }
+        return false;
+    }
+
+    /**
+     * Renames a declaration and all of its references. If a scope is given, only the references
+     * inside it are renamed.
+     */
+    public rename(decl: Vardecl, newName: string, scope?: Joinpoint): void {
+        const oldName = decl.name;
+        const refs = scope != undefined
+            ? this.getRefsOf(decl).filter((ref) => DefUseIndex.isInside(ref, scope))
+            : this.getRefsOf(decl);
+
+        for (const ref of refs) {
+            ref.setName(newName);
+        }
+        decl.setName(newName);
+
+        const refIds = new Set(refs.map((ref) => ref.astId));
+        const remaining = this.getRefs(oldName).filter((ref) => !refIds.has(ref.astId));
+        this.setOrDelete(this.refsByName, oldName, remaining);
+        this.refsByName.set(newName, [...this.getRefs(newName), ...refs]);
+
+        this.setOrDelete(this.declsByName, oldName, this.getDecls(oldName).filter((d) => d.astId !== decl.astId));
+        this.declsByName.set(newName, [...this.getDecls(newName), decl]);
+    }
+
+    /**
+     * Replaces a reference with an expression, indexing any references inside the new expression.
+     * @returns the expression now in the AST
+     */
+    public replaceRef(ref: Varref, expr: Expression): Expression {
+        this.removeRef(ref);
+        const inserted = ref.replaceWith(expr) as Expression;
+
+        for (const newRef of Query.searchFromInclusive(inserted, Varref)) {
+            this.addRef(newRef);
+        }
+        return inserted;
+    }
+
+    private removeRef(ref: Varref): void {
+        this.ensureBuilt();
+        this.setOrDelete(this.refsByName, ref.name, this.getRefs(ref.name).filter((r) => r.astId !== ref.astId));
+
+        const decl = this.declByRef.get(ref.astId);
+        if (decl != undefined) {
+            const refs = this.refsByDecl.get(decl.astId) ?? [];
+            this.refsByDecl.set(decl.astId, refs.filter((r) => r.astId !== ref.astId));
+            this.declByRef.delete(ref.astId);
+        }
+    }
+
+    private addRef(ref: Varref): void {
+        if (!this.refsByName.has(ref.name)) {
+            this.refsByName.set(ref.name, []);
+        }
+        this.refsByName.get(ref.name)!.push(ref);
+
+        const decl = ref.vardecl;
+        if (decl == undefined) {
+            return;
+        }
+        if (!this.refsByDecl.has(decl.astId)) {
+            this.refsByDecl.set(decl.astId, []);
+        }
+        this.refsByDecl.get(decl.astId)!.push(ref);
+        this.declByRef.set(ref.astId, decl);
+    }
+
+    private ensureBuilt(): void {
+        if (this.isBuilt) {
+            return;
+        }
+        this.isBuilt = true;
+
+        for (const decl of Query.searchFrom(this.root, Vardecl)) {
+            if (!this.declsByName.has(decl.name)) {
+                this.declsByName.set(decl.name, []);
+            }
+            this.declsByName.get(decl.name)!.push(decl);
+        }
+        for (const ref of Query.searchFrom(this.root, Varref)) {
+            this.addRef(ref);
+        }
+    }
+
+    private setOrDelete<T>(map: Map<string, T[]>, key: string, values: T[]): void {
+        if (values.length > 0) {
+            map.set(key, values);
+        }
+        else {
+            map.delete(key);
+        }
+    }
+
+    private static isInside(jp: Joinpoint, ancestor: Joinpoint): boolean {
+        for (let current: Joinpoint | undefined = jp; current != undefined; current = current.parent) {
+            if (current.astId === ancestor.astId) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -1,16 +1,30 @@
-import { BinaryOp, Call, DeclStmt, Expression, FloatLiteral, FunctionJp, IntLiteral, Literal, Param, ParenExpr, ReturnStmt, Statement, Type, UnaryOp, Vardecl, VariableArrayType, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import { Call, DeclStmt, Expression, FloatLiteral, FunctionJp, GotoStmt, IntLiteral, LabelStmt, Literal, Param, ParenExpr, ReturnStmt, Statement, Type, UnaryOp, Vardecl, VariableArrayType, Varref } from "@specs-feup/clava/api/Joinpoints.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
+import { AstPredicates } from "../AstPredicates.js";
 import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
 import NormalizeToSubset from "@specs-feup/clava/api/clava/opt/NormalizeToSubset.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { CallGraph } from "../program/CallGraph.js";
+import { Speculation } from "../Speculation.js";
+import { DefUseIndex } from "./DefUseIndex.js";
 
 export class Inliner extends AdvancedTransform {
+    private lastInlined: Statement[] = [];
+
     constructor(silent: boolean = false) {
         super("Inliner", silent);
     }
 
+    /**
+     * Returns the statements inserted by the last successful call to inline(), in order.
+     */
+    public getLastInlinedStatements(): Statement[] {
+        return this.lastInlined;
+    }
+
     public inline(call: Call, prefix: string = "_i"): boolean {
+        this.lastInlined = [];
         if (!this.canInline(call)) {
             return false;
         }
@@ -40,17 +54,47 @@ export class Inliner extends AdvancedTransform {
             inlineBegin.insertAfter(stmt);
         }
 
+        this.markDirty(callStmt);
         callStmt.detach();
         this.detachClonedFunction(clone);
+        CallGraph.invalidate();
 
         for (const stmt of transStmts) {
             this.santitizeStatement(stmt);
         }
+        // transStmts was reversed in place for the insertion above
+        this.lastInlined = transStmts.slice().reverse();
 
         this.log(`Successfully inlined function ${fun.name}.`);
         return true;
     }
 
+    /**
+     * Same as inline(), but speculative: if inlining fails midway (e.g., the callee cannot be normalized), or the
+     * inlined statements are rejected by isProfitable, the caller is restored and the clone of the callee is removed,
+     * without rebuilding the AST. On rollback, the call is no longer in the AST.
+     */
+    public tryInline(call: Call, prefix: string = "_i", isProfitable: (inlined: Statement[]) => boolean = () => true): boolean {
+        const caller = call.getAncestor("function") as FunctionJp | undefined;
+        if (caller == undefined) {
+            this.logError(`Call at ${call.location} is not inside a function.`);
+            return false;
+        }
+        // nothing is changed when the call cannot be inlined at all, so there is no need for a snapshot
+        if (!this.canInline(call)) {
+            return false;
+        }
+        const speculation = new Speculation(this.silent);
+        const { accepted } = speculation.attempt([caller],
+            () => this.inline(call, prefix),
+            (inlined) => inlined && isProfitable(this.lastInlined));
+
+        if (!accepted) {
+            this.lastInlined = [];
+        }
+        return accepted;
+    }
+
     public canInline(call: Call): boolean {
         if (call == null) {
             this.logError("Call joinpoint is null.");
@@ -61,7 +105,7 @@ export class Inliner extends AdvancedTransform {
             return false;
         }
         const retType = call.function.returnType;
-        const isVoidReturn = retType.code.includes("void");
+        const isVoidReturn = AstPredicates.isVoidType(retType);
         const isImpl = call.function.isImplementation;
 
         if (!isImpl) {
@@ -102,39 +146,27 @@ export class Inliner extends AdvancedTransform {
                 varsToRename.push(vardecl);
             }
         }
+        const index = new DefUseIndex(fun);
         for (const vardecl of varsToRename) {
             const baseName = `${vardecl.name}_renamed_`;
-            const newName = IdGenerator.next(baseName);
-
-            for (const varref of Query.searchFrom(fun, Varref, { name: vardecl.name }).get()) {
-                varref.setName(newName);
-            }
-            vardecl.setName(newName);
+            index.rename(vardecl, IdGenerator.next(baseName));
         }
     }
 
-    private isNeverReassigned(param: Param, fun: FunctionJp): boolean {
-        for (const varref of Query.searchFrom(fun.body, Varref, { name: param.name }).get()) {
-            const binaryOp = varref.getAncestor("binaryOp") as BinaryOp;
-            if (binaryOp == null || binaryOp.operator != "=") {
-                continue;
-            }
-            if (binaryOp.left.code == param.name) {
-                return false;
-            }
-        }
-        return true;
+    private isNeverReassigned(param: Param, index: DefUseIndex): boolean {
+        return !index.isReassigned(param);
     }
 
     protected transformStatements(fun: FunctionJp, call: Call, id: string): Statement[] {
         const transformedStmts: Statement[] = [];
 
         const argToParamMap = new Map<string, Expression>();
+        const index = new DefUseIndex(fun);
         for (let i = 0; i < call.args.length; i++) {
             const arg = call.args[i];
             const param = fun.params[i];
 
-            if (this.isNeverReassigned(param, fun)) {
+            if (this.isNeverReassigned(param, index)) {
                 argToParamMap.set(param.name, arg);
             }
             else {
@@ -144,12 +176,13 @@ export class Inliner extends AdvancedTransform {
                 transformedStmts.push(declStmt);
                 const newVarref = newVardecl.varref();
                 argToParamMap.set(param.name, newVarref);
-                this.log(` Param ${param.name} is reassigned in ${fun.name}; created local copy ${newVarName}.`);
+                this.logDebug(() => ` Param ${param.name} is reassigned in ${fun.name}; created local copy ${newVarName}.`);
             }
         }
 
         let useEndLabel = false;
         const endLabel = ClavaJoinPoints.labelDecl(`end_inline${id}`);
+        this.renameLabels(fun, id);
 
         const stmts = fun.body.stmts;
         for (const stmt of stmts) {
@@ -199,6 +232,24 @@ export class Inliner extends AdvancedTransform {
         return transformedStmts;
     }
 
+    // the callee may have labels of its own (e.g., from a previous inlining),
+    // which would be duplicated if it is inlined more than once into the same function
+    private renameLabels(fun: FunctionJp, id: string): void {
+        const newNames = new Map<string, string>();
+
+        for (const label of Query.searchFrom(fun.body, LabelStmt).get()) {
+            const newName = `${label.decl.name}${id}`;
+            newNames.set(label.decl.name, newName);
+            label.decl.setName(newName);
+        }
+        for (const gotoStmt of Query.searchFrom(fun.body, GotoStmt).get()) {
+            const newName = newNames.get(gotoStmt.label.name);
+            if (newName != undefined) {
+                gotoStmt.label.setName(newName);
+            }
+        }
+    }
+
     private getVarrefsInInit(fun: FunctionJp, stmt: Statement): Varref[] {
         const varrefs: Varref[] = [];
         for (const vardecl of Query.searchFrom(stmt, Vardecl).get()) {
@@ -1,9 +1,69 @@
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
-import { AdjustedType, ArrayType, BinaryOp, Break, BuiltinType, Call, Continue, DeclStmt, ElaboratedType, Expression, FunctionJp, GotoStmt, If, Joinpoint, LabelStmt, Literal, MemberAccess, Param, ParenExpr, PointerType, QualType, ReturnStmt, Scope, Statement, TypedefType, UnaryOp, Vardecl, Varref, WrapperStmt } from "@specs-feup/clava/api/Joinpoints.js";
+import { AdjustedType, ArrayType, BinaryOp, BuiltinType, Call, DeclStmt, ElaboratedType, Expression, FunctionJp, GotoStmt, If, Joinpoint, LabelStmt, Literal, MemberAccess, Param, ParenExpr, PointerType, Pragma, QualType, ReturnStmt, Scope, Statement, TypedefType, UnaryOp, Vardecl, Varref, WrapperStmt } from "@specs-feup/clava/api/Joinpoints.js";
 import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
+import { AstPredicates } from "../AstPredicates.js";
 import { ScopeFlattener } from "../flattening/ScopeFlattener.js";
+import { CallGraph } from "../program/CallGraph.js";
+import { Speculation } from "../Speculation.js";
+import { DefUseIndex } from "./DefUseIndex.js";
+
+/**
+ * Analysis of a function shared by all the regions outlined from it by outlineAll(). It is computed
+ * once, before any region is outlined, and maps every statement to its position in a pre-order walk.
+ * Regions are outlined from last to first, so the positions of everything before the region being
+ * outlined, and the names used after it, are the same as in the original function.
+ */
+class OutlineContext {
+    private stmtIndex: Map<string, number> = new Map();
+    private lastUse: Map<string, number> = new Map();
+    private declsInOrder: [number, Vardecl][] = [];
+    public readonly nGlobals: number;
+
+    constructor(fun: FunctionJp, nGlobals: number) {
+        this.nGlobals = nGlobals;
+
+        Query.searchFrom(fun, Statement).get().forEach((stmt, idx) => {
+            this.stmtIndex.set(stmt.astId, idx);
+        });
+        for (const varref of Query.searchFrom(fun, Varref)) {
+            const idx = this.indexOfEnclosing(varref);
+            this.lastUse.set(varref.name, Math.max(this.lastUse.get(varref.name) ?? -1, idx));
+        }
+        for (const decl of Query.searchFrom(fun, Vardecl)) {
+            const idx = this.indexOfEnclosing(decl);
+            if (idx >= 0) {
+                this.declsInOrder.push([idx, decl]);
+            }
+        }
+    }
+
+    public indexOf(stmt: Statement): number {
+        return this.stmtIndex.get(stmt.astId) ?? -1;
+    }
+
+    /**
+     * Checks whether a name is referenced by any statement after the given one and its children
+     */
+    public isUsedAfter(name: string, stmt: Statement): boolean {
+        const lastInSubtree = this.indexOf(stmt) + Query.searchFrom(stmt, Statement).get().length;
+        return (this.lastUse.get(name) ?? -1) > lastInSubtree;
+    }
+
+    /**
+     * Returns the declarations that come before the given statement
+     */
+    public getDeclsBefore(stmt: Statement): Vardecl[] {
+        const idx = this.indexOf(stmt);
+        return this.declsInOrder.filter(([declIdx]) => declIdx < idx).map(([, decl]) => decl);
+    }
+
+    private indexOfEnclosing(jp: Joinpoint): number {
+        const stmt = jp.getAncestor("statement") as Statement | undefined;
+        return stmt != undefined ? this.indexOf(stmt) : -1;
+    }
+}
 
 export class Outliner extends AdvancedTransform {
     private defaultPrefix: string;
@@ -35,16 +95,93 @@ export class Outliner extends AdvancedTransform {
     }
 
     public outlineWithWrappers(begin: WrapperStmt, end: WrapperStmt, outlineAllDecls: boolean = false): [FunctionJp, Call] | [null, null] {
+        const resolved = this.resolveWrappers(begin, end);
+        if (resolved == null) {
+            return [null, null];
+        }
+        const [beginStmt, endStmt, funName] = resolved;
+        begin.detach();
+        end.detach();
+
+        return this.outlineWithName(beginStmt, endStmt, funName, outlineAllDecls);
+    }
+
+    /**
+     * Outlines every region of a function delimited by a "#pragma clava begin_outline [name]" and a
+     * "#pragma clava end_outline" pair at the same scope level. The function is analysed only once,
+     * and the regions are outlined from last to first so that this analysis stays valid.
+     * @param {FunctionJp} fun - the function with the outlining pragmas
+     * @returns the outlined functions and the calls to them, in source order
+     */
+    public outlineAll(fun: FunctionJp, outlineAllDecls: boolean = false): [FunctionJp, Call][] {
+        const ranges: [Statement, Statement, string][] = [];
+
+        for (const beginPragma of Query.searchFrom(fun, Pragma, (p) => p.content.startsWith("begin_outline"))) {
+            const beginWrapper = beginPragma.parent as WrapperStmt;
+            const endWrapper = beginWrapper.siblingsRight.find((stmt) => {
+                return stmt instanceof WrapperStmt && stmt.children[0] instanceof Pragma && (stmt.children[0] as Pragma).content.startsWith("end_outline");
+            }) as WrapperStmt | undefined;
+
+            if (endWrapper == undefined) {
+                this.logError(`Could not find a matching end_outline pragma for the region at line ${beginWrapper.line}`);
+                continue;
+            }
+            const resolved = this.resolveWrappers(beginWrapper, endWrapper);
+            if (resolved == null) {
+                continue;
+            }
+            beginWrapper.detach();
+            endWrapper.detach();
+            ranges.push(resolved);
+        }
+        return this.outlineAllRanges(ranges, outlineAllDecls);
+    }
+
+    /**
+     * Outlines a list of regions, each delimited by two statements at the same scope level and with
+     * an optional function name. Regions in the same function share the same analysis (see outlineAll()).
+     * @returns the outlined functions and the calls to them, in the same order as the ranges
+     */
+    public outlineAllRanges(ranges: [Statement, Statement, string?][], outlineAllDecls: boolean = false): [FunctionJp, Call][] {
+        const contexts = new Map<string, OutlineContext>();
+        const nGlobals = this.findGlobalVars().length;
+        const getContext = (stmt: Statement): OutlineContext | undefined => {
+            const fun = stmt.getAncestor("function") as FunctionJp | undefined;
+            if (fun == undefined) {
+                return undefined;
+            }
+            if (!contexts.has(fun.astId)) {
+                contexts.set(fun.astId, new OutlineContext(fun, nGlobals));
+            }
+            return contexts.get(fun.astId);
+        };
+
+        // contexts are built before outlining anything, so that all positions refer to the original functions
+        const withContext = ranges.map(([begin, end, name], idx) => {
+            const ctx = getContext(begin);
+            return { begin, end, name: name ?? this.generateFunctionName(), idx, ctx, pos: ctx?.indexOf(begin) ?? -1 };
+        });
+        const results: ([FunctionJp, Call] | [null, null])[] = new Array(ranges.length);
+
+        for (const range of [...withContext].sort((r1, r2) => r2.pos - r1.pos)) {
+            results[range.idx] = this.outlineRegion(range.begin, range.end, range.name, outlineAllDecls, range.ctx);
+        }
+        const outlined = results.filter((res): res is [FunctionJp, Call] => res[0] != null);
+        this.log(`Outlined ${outlined.length} of ${ranges.length} regions`);
+        return outlined;
+    }
+
+    private resolveWrappers(begin: WrapperStmt, end: WrapperStmt): [Statement, Statement, string] | null {
         const beginPragma = begin.code.trim().replace(/\s+/g, ' ').replace(";", "");
         const endPragma = end.code.trim().replace(/\s+/g, ' ').replace(";", "");
 
         if (!beginPragma.toLowerCase().includes("#pragma clava begin_outline")) {
             this.logError("Provided begin wrapper is not a valid outlining pragma! Begin = " + beginPragma);
-            return [null, null];
+            return null;
         }
         if (!endPragma.toLowerCase().includes("#pragma clava end_outline")) {
             this.logError("Provided end wrapper is not a valid outlining pragma! End = " + endPragma);
-            return [null, null];
+            return null;
         }
         const funName = beginPragma.split(" ")[3] || this.generateFunctionName();
 
@@ -54,12 +191,9 @@ export class Outliner extends AdvancedTransform {
 
         if (beginStmt == null || endStmt == null) {
             this.logError("Could not find the statements to outline! Begin = " + beginStmt + ", end = " + endStmt);
-            return [null, null];
+            return null;
         }
-        begin.detach();
-        end.detach();
-
-        return this.outlineWithName(beginStmt, endStmt, funName, outlineAllDecls);
+        return [beginStmt, endStmt, funName];
     }
 
     /**
@@ -73,6 +207,31 @@ export class Outliner extends AdvancedTransform {
      * These values are merely references, and all changes have already been committed to the AST at this point
      */
     public outlineWithName(begin: Statement, end: Statement, functionName: string, outlineAllDecls: boolean = false): [FunctionJp, Call] | [null, null] {
+        return this.outlineRegion(begin, end, functionName, outlineAllDecls);
+    }
+
+    /**
+     * Same as outlineWithName(), but speculative: if outlining fails midway, or the result is rejected by isProfitable,
+     * the enclosing function is restored and the outlined function is removed, without rebuilding the AST.
+     * On rollback, begin and end are no longer in the AST.
+     */
+    public tryOutlineWithName(begin: Statement, end: Statement, functionName: string, outlineAllDecls: boolean = false, isProfitable: (fun: FunctionJp, call: Call) => boolean = () => true): [FunctionJp, Call] | [null, null] {
+        const parentFun = begin.getAncestor("function") as FunctionJp | undefined;
+        if (parentFun == undefined) {
+            this.logError("Could not find parent function for the outline region");
+            return [null, null];
+        }
+        const speculation = new Speculation(this.silent);
+        const { accepted, result } = speculation.attempt([parentFun],
+            () => this.outlineWithName(begin, end, functionName, outlineAllDecls),
+            ([fun, call]) => fun != null && isProfitable(fun, call!));
+
+        return accepted ? result! : [null, null];
+    }
+
+    private outlineRegion(begin: Statement, end: Statement, functionName: string, outlineAllDecls: boolean, ctx?: OutlineContext): [FunctionJp, Call] | [null, null] {
+        const originalBegin = begin;
+        const originalEnd = end;
         this.log("Attempting to outline a region into a function named \"" + functionName + "\"");
 
         //------------------------------------------------------------------------------
@@ -94,17 +253,27 @@ export class Outliner extends AdvancedTransform {
             this.logError("Could not find parent function for the outline region");
             return [null, null];
         }
-        const split = this.splitRegions(parentFun, begin, end);
-
-        let region = split[1];
-        const prologue = split[0];
-        const epilogue = split[2];
+        let region: Statement[];
+        const prologueDecls: Vardecl[] = [];
+        let epilogue: Statement[] = [];
+
+        if (ctx == undefined) {
+            const split = this.splitRegions(parentFun, begin, end);
+            region = split[1];
+            epilogue = split[2];
+            prologueDecls.push(...this.findDeclsIn(split[0]));
+            this.log("Prologue has " + split[0].length + " statements, and epilogue has " + epilogue.length);
+        }
+        else {
+            region = this.getSiblingRegion(begin, end);
+            prologueDecls.push(...ctx.getDeclsBefore(originalBegin));
+            this.log("Prologue has " + prologueDecls.length + " declarations");
+        }
         this.log("Found " + region.length + " statements for the outline region");
-        this.log("Prologue has " + prologue.length + " statements, and epilogue has " + epilogue.length);
 
         //------------------------------------------------------------------------------
-        const globals = this.findGlobalVars();
-        this.log("Found " + globals.length + " global variable(s)");
+        const nGlobals = ctx != undefined ? ctx.nGlobals : this.findGlobalVars().length;
+        this.log("Found " + nGlobals + " global variable(s)");
 
         //------------------------------------------------------------------------------
         const callPlaceholder = ClavaJoinPoints.stmtLiteral("//placeholder for the call to " + functionName);
@@ -113,13 +282,15 @@ export class Outliner extends AdvancedTransform {
 
         //------------------------------------------------------------------------------
         if (!outlineAllDecls) {
-            const declareBefore = this.findDeclsWithDependency(region, epilogue);
+            const declareBefore = ctx == undefined ?
+                this.findDeclsWithDependency(region, epilogue) :
+                this.findDeclsUsedAfter(region, ctx, originalEnd);
             region = region.filter((stmt) => !declareBefore.includes(stmt as DeclStmt));
             for (var i = declareBefore.length - 1; i >= 0; i--) {
                 const decl = declareBefore[i];
                 decl.detach();
                 begin.insertBefore(decl);
-                prologue.push(decl);
+                prologueDecls.push(...this.findDeclsIn([decl]));
             }
             this.log("Moved declarations from outline region to immediately before the region");
         }
@@ -131,7 +302,7 @@ export class Outliner extends AdvancedTransform {
         this.log(`Successfully created function "${functionName}"`);
 
         //------------------------------------------------------------------------------
-        const callArgs = this.createArgs(fun, prologue, parentFun);
+        const callArgs = this.createArgs(fun, prologueDecls, parentFun);
         let call = this.updateCall(callPlaceholder, fun, callArgs);
         this.log(`Successfully created call to "${functionName}"`);
 
@@ -181,6 +352,9 @@ export class Outliner extends AdvancedTransform {
         // Victory, at last
         begin.detach();
         end.detach();
+        this.markDirty(parentFun);
+        this.markDirty(fun);
+        CallGraph.invalidate();
         this.log("Finished cleanup");
 
         return [fun, call];
@@ -216,16 +390,18 @@ export class Outliner extends AdvancedTransform {
     private transformPointerReassignments(fun: FunctionJp, call: Call): void {
         const reassignedPointerParams: Param[] = [];
 
+        const index = new DefUseIndex(fun);
+
         fun.params.forEach((param) => {
             if (param.type instanceof PointerType) {
                 // const pointee = param.type.pointee.desugarAll;
                 // if (pointee instanceof BuiltinType) {
                 //     return;
                 // }
-                for (const varref of Query.searchFrom(fun.body, Varref, { name: param.name })) {
+                for (const varref of index.getRefsOf(param)) {
                     if (varref.parent instanceof BinaryOp) {
                         const binOp = varref.parent as BinaryOp;
-                        if (binOp.isAssignment && binOp.left.code === varref.code) {
+                        if (binOp.isAssignment && AstPredicates.isSameLvalue(binOp.left, varref)) {
                             if (this.exprIsPointer(binOp.right)) {
                                 reassignedPointerParams.push(param);
                                 break;
@@ -237,7 +413,7 @@ export class Outliner extends AdvancedTransform {
         });
         reassignedPointerParams.forEach((param) => {
             // Dereference every reference
-            for (const varref of Query.searchFrom(fun, Varref, { name: param.name })) {
+            for (const varref of index.getRefsOf(param)) {
                 if (varref.type.code !== param.type.code) {
                     continue;
                 }
@@ -263,21 +439,21 @@ export class Outliner extends AdvancedTransform {
     // if(__prematureExit0 == 1) { break; }
     private cleanupBreaks(fun: FunctionJp): void {
         for (const stmt of fun.body.stmts) {
-            if (stmt instanceof Break) {
+            if (AstPredicates.isBreak(stmt)) {
                 const returnStmt = ClavaJoinPoints.returnStmt();
                 stmt.replaceWith(returnStmt);
             }
 
             if (stmt instanceof If) {
                 for (const innerStmt of stmt.then.stmts) {
-                    if (innerStmt.code == "break;") {
+                    if (AstPredicates.isBreak(innerStmt)) {
                         const returnStmt = ClavaJoinPoints.returnStmt();
                         innerStmt.replaceWith(returnStmt);
                     }
                 }
                 if (stmt.else != null) {
                     for (const innerStmt of stmt.else.stmts) {
-                        if (innerStmt.code == "break;") {
+                        if (AstPredicates.isBreak(innerStmt)) {
                             const returnStmt = ClavaJoinPoints.returnStmt();
                             innerStmt.replaceWith(returnStmt);
                         }
@@ -290,9 +466,9 @@ export class Outliner extends AdvancedTransform {
     private removeContinues(fun: FunctionJp, call: Call): void {
         const continues: Statement[] = [];
         // Although we have a Continue jp type, some continues may be a generic Statement type generated by stmtLiteral()
-        // This code catches both cases
+        // AstPredicates catches both cases without printing every statement
         for (const stmt of Query.searchFrom(fun, Statement)) {
-            if (stmt.code == "continue;") {
+            if (AstPredicates.isContinue(stmt)) {
                 if (stmt.getAncestor("loop") == null && stmt.getAncestor("switch") == null) {
                     continues.push(stmt);
                 }
@@ -332,12 +508,20 @@ export class Outliner extends AdvancedTransform {
         }
     }
 
+    private assignsPrematureExit(stmt: Statement): boolean {
+        // statements created with stmtLiteral() have no children, and printing them is cheap
+        if (stmt.children.length == 0) {
+            return stmt.code.includes("__prem");
+        }
+        return Query.searchFromInclusive(stmt, Varref, (ref) => ref.name.startsWith("__prem")).first() != undefined;
+    }
+
     private removeBreaks(fun: FunctionJp, call: Call): void {
         const breaks: Statement[] = [];
         // Although we have a Break jp type, some breaks may be a generic Statement type generated by stmtLiteral()
-        // This code catches both cases
+        // AstPredicates catches both cases without printing every statement
         for (const stmt of Query.searchFrom(fun, Statement)) {
-            if (stmt.code == "break;") {
+            if (AstPredicates.isBreak(stmt)) {
                 if (stmt.getAncestor("loop") == null && stmt.getAncestor("switch") == null) {
                     breaks.push(stmt);
                 }
@@ -353,7 +537,7 @@ export class Outliner extends AdvancedTransform {
             // add it as a "break" if the previous statement was a premature exit assignment
             // a better check would be if it is an assignment to a premature exit variable
             const prevStmt = retScope.stmts.at(-2)!;
-            if (prevStmt.code.includes("__prem")) {
+            if (this.assignsPrematureExit(prevStmt)) {
                 breaks.push(ret);
             }
         }
@@ -443,7 +627,7 @@ export class Outliner extends AdvancedTransform {
         // now that we have a baseline valid region, let's check for specific requirements within the region
         // TS conversion: we need to explicitly cast the parentFun to FunctionJp because it could be null,
         // despite having checked for it earlier
-        const region = this.splitRegions(parentFun as FunctionJp, begin, end)[1];
+        const region = this.getSiblingRegion(begin, end);
 
         if (this.checkOutOfRegionGotos(region)) {
             this.logError("Requirement not met: outlinable region must not contain any goto statements that jump outside of the region");
@@ -573,14 +757,19 @@ export class Outliner extends AdvancedTransform {
         return call;
     }
 
-    private createArgs(fun: FunctionJp, prologue: Statement[], parentFun: FunctionJp): Expression[] {
+    private findDeclsIn(stmts: Statement[]): Vardecl[] {
         const decls = [];
-        // get decls from the prologue
-        for (const stmt of prologue) {
+        for (const stmt of stmts) {
             for (const decl of Query.searchFrom(stmt, Vardecl)) {
                 decls.push(decl);
             }
         }
+        return decls;
+    }
+
+    private createArgs(fun: FunctionJp, prologueDecls: Vardecl[], parentFun: FunctionJp): Expression[] {
+        // decls from the prologue
+        const decls = [...prologueDecls];
         // get decls from the parent function params
         for (const param of Query.searchFrom(parentFun, Param)) {
             decls.push(param.definition);
@@ -840,6 +1029,32 @@ export class Outliner extends AdvancedTransform {
         return declsWithDependency;
     }
 
+    private findDeclsUsedAfter(region: Statement[], ctx: OutlineContext, end: Statement): DeclStmt[] {
+        const declsWithDependency = region.filter((stmt) => {
+            return stmt instanceof DeclStmt && ctx.isUsedAfter((stmt.children[0] as Vardecl).name, end);
+        }) as DeclStmt[];
+
+        this.log("Found " + declsWithDependency.length + " declaration(s) referenced after the outline region");
+        return declsWithDependency;
+    }
+
+    /**
+     * Returns the statements from begin to end (both inclusive) at the same scope level
+     */
+    private getSiblingRegion(begin: Statement, end: Statement): Statement[] {
+        const region = [begin];
+        if (begin.astId === end.astId) {
+            return region;
+        }
+        for (const sibling of begin.siblingsRight) {
+            region.push(sibling as Statement);
+            if (sibling.astId === end.astId) {
+                break;
+            }
+        }
+        return region;
+    }
+
     private splitRegions(fun: FunctionJp, begin: Statement, end: Statement) {
         const prologue = []
         const region = [];
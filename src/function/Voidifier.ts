@@ -4,6 +4,7 @@ import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { CallGraph } from "../program/CallGraph.js";
 
 export class Voidifier extends AdvancedTransform {
     constructor(silent: boolean = false) {
@@ -29,6 +30,7 @@ export class Voidifier extends AdvancedTransform {
         calls.forEach((call) => {
             this.handleCall(call, fun, retVarType, copyStructs);
         });
+        CallGraph.invalidate();
 
         this.log(`Voidified function ${fun.name}`);
         return true;
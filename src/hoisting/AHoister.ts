@@ -1,6 +1,7 @@
 import { Call, FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { CallGraph } from "../program/CallGraph.js";
 
 export abstract class AHoister extends AdvancedTransform {
     constructor(silent: boolean = false, name: string = "AHoister") {
@@ -41,17 +42,7 @@ export abstract class AHoister extends AdvancedTransform {
     }
 
     protected verifyHoistConditions(call: Call, targetPoint: FunctionJp): boolean {
-        const funChain = this.getFunctionChain(targetPoint);
-        let inChain = false;
-        for (const func of funChain) {
-            for (const c of Query.searchFrom(func, Call)) {
-                if (c.astId === call.astId) {
-                    inChain = true;
-                    break;
-                }
-            }
-        }
-        return inChain;
+        return CallGraph.get().isCallReachableFrom(call, targetPoint);
     }
 
     protected abstract hoist(call: Call, targetPoint: FunctionJp): boolean;
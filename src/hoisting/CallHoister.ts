@@ -21,9 +21,9 @@ export class CallHoister extends AHoister {
             const hoisted = this.hoist(call, targetPoint);
             if (hoisted) {
                 hoistedCount++;
-                this.log(`Successfully hoisted call ${call.code}`);
+                this.log(() => `Successfully hoisted call ${call.code}`);
             } else {
-                this.log(`Failed to hoist call ${call.code}`);
+                this.log(() => `Failed to hoist call ${call.code}`);
             }
         }
         return hoistedCount;
@@ -4,6 +4,8 @@ import { AHoister } from "./AHoister.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
 import { CallTreeInliner } from "../function/CallTreeInliner.js";
 import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
+import { CallGraph } from "../program/CallGraph.js";
+import { PlanCandidate, TransformPlan } from "../TransformPlan.js";
 
 export class MallocHoister extends AHoister {
 
@@ -58,6 +60,100 @@ export class MallocHoister extends AHoister {
         return hoistedCount;
     }
 
+    /**
+     * Analysis-only counterpart of hoistAllMallocs(): lists the malloc/calloc calls that would be hoisted
+     * to the target point, and the bytes they allocate, without inlining or changing anything.
+     * Calls outside of the target point are only legal if the call tree is inlined first.
+     */
+    public planHoistAllMallocs(targetPoint?: FunctionJp, skipInlining: boolean = false): TransformPlan {
+        const start = Date.now();
+        const candidates: PlanCandidate[] = [];
+        const actualPoint = this.getTargetPoint(targetPoint);
+        if (actualPoint == undefined) {
+            this.logError("No valid target point found for malloc hoisting.");
+            return this.makePlan(candidates, start);
+        }
+
+        const callGraph = CallGraph.get();
+        const blockers = this.getInliningBlockers(callGraph, actualPoint);
+
+        for (const fun of callGraph.getReachable(actualPoint)) {
+            for (const call of callGraph.getCallSites(fun)) {
+                if (call.name !== "malloc" && call.name !== "calloc") {
+                    continue;
+                }
+                const sizeKnown = call.args[0] instanceof IntLiteral || this.hasSizePragma(call);
+                const candidate: PlanCandidate = {
+                    site: `${call.name}() at ${call.location}`,
+                    function: fun.name,
+                    legal: true,
+                    reasons: [],
+                    benefit: { allocationsHoisted: 1, bytesHoisted: sizeKnown ? this.getSize(call) : 16 }
+                };
+                const assignment = call.getAncestor("binaryOp") as BinaryOp | undefined;
+                if (assignment == undefined || !assignment.isAssignment) {
+                    candidate.legal = false;
+                    candidate.reasons.push("Result is not assigned to any variable");
+                }
+                if (fun.name !== actualPoint.name) {
+                    if (skipInlining) {
+                        candidate.legal = false;
+                        candidate.reasons.push(`Located in ${fun.name}(), and inlining is skipped`);
+                    }
+                    else if (blockers.has(fun.astId)) {
+                        candidate.legal = false;
+                        candidate.reasons.push(`Located in ${fun.name}(), which cannot be inlined into ${actualPoint.name}(): ${blockers.get(fun.astId)!.join("; ")}`);
+                    }
+                    else {
+                        candidate.reasons.push(`Requires inlining ${fun.name}() into ${actualPoint.name}()`);
+                    }
+                }
+                if (!sizeKnown) {
+                    candidate.reasons.push("Size is unknown, assuming 16 bytes");
+                }
+                candidates.push(candidate);
+            }
+        }
+        return this.makePlan(candidates, start);
+    }
+
+    /**
+     * Walks the call tree of the target point through the calls the CallTreeInliner would inline, and
+     * returns, for every function the walk does not reach, the reasons the first call to it was blocked
+     */
+    private getInliningBlockers(callGraph: CallGraph, targetPoint: FunctionJp): Map<string, string[]> {
+        const inliner = new CallTreeInliner(true);
+        const recursive = new Set(callGraph.getRecursiveComponents(targetPoint).flat());
+        const blockers = new Map<string, string[]>();
+        const inlined = new Set<string>([targetPoint.astId]);
+        const pending = [targetPoint];
+
+        while (pending.length > 0) {
+            const caller = pending.pop()!;
+            for (const callee of callGraph.getCallees(caller)) {
+                if (inlined.has(callee.astId)) {
+                    continue;
+                }
+                const reasons = inliner.getInlineBlockers(caller.name, callee, recursive);
+                if (reasons.length > 0) {
+                    if (!blockers.has(callee.astId)) {
+                        blockers.set(callee.astId, reasons);
+                    }
+                    continue;
+                }
+                inlined.add(callee.astId);
+                blockers.delete(callee.astId);
+                pending.push(callee);
+            }
+        }
+        for (const fun of callGraph.getReachable(targetPoint)) {
+            if (!inlined.has(fun.astId) && !blockers.has(fun.astId)) {
+                blockers.set(fun.astId, [`Only called from functions that cannot be inlined`]);
+            }
+        }
+        return blockers;
+    }
+
     public hoistMalloc(call: Call, targetPoint: FunctionJp, inlineTree: boolean = true): boolean {
         if (inlineTree) {
             this.inlineAll(targetPoint);
@@ -93,11 +189,13 @@ export class MallocHoister extends AHoister {
         targetPoint.setParams([...targetPoint.params, newParam]);
 
         // update malloc assignment to use the param instead
+        const callGraph = CallGraph.get();
         const newVarref = newParam.varref();
         assignment.right.replaceWith(newVarref);
+        callGraph.removeCall(call);
 
         // update every call to parentFun to have the hoisted malloc just before
-        const callsToParent = Query.search(Call, { name: targetPoint.name }).get();
+        const callsToParent = callGraph.getCallsTo(targetPoint);
         for (const call of callsToParent) {
             const callExpr = call.parent as ExprStmt;
 
@@ -135,6 +233,12 @@ export class MallocHoister extends AHoister {
     }
 
 
+    private hasSizePragma(call: Call): boolean {
+        const stmt = call.getAncestor("exprStmt") as ExprStmt | undefined;
+        const prevSibling = stmt?.siblingsLeft.at(-1);
+        return prevSibling instanceof WrapperStmt && /\bmax\s*=\s*(\d+)/.test(prevSibling.code);
+    }
+
     private getSize(call: Call): number {
         if (call.args[0] instanceof IntLiteral) {
             return call.args[0].value;
@@ -152,17 +256,19 @@ export class MallocHoister extends AHoister {
     }
 
     private removeFrees(targetPoint: FunctionJp): number {
-        const frees = Query.searchFrom(targetPoint, Call, (c) => c.name === "free").get();
+        const callGraph = CallGraph.get();
+        const frees = callGraph.getCallSites(targetPoint).filter((c) => c.name === "free");
         frees.forEach((freeCall) => {
             const exprStmt = freeCall.getAncestor("exprStmt") as ExprStmt;
             const comment = ClavaJoinPoints.comment(exprStmt.code);
             exprStmt.replaceWith(comment);
+            callGraph.removeCall(freeCall);
         });
         return frees.length;
     }
 
     private inlineAll(startingPoint: FunctionJp): boolean {
         const callTreeInliner = new CallTreeInliner();
-        return callTreeInliner.inlineCallTree(startingPoint, true, "_i");
+        return callTreeInliner.inlineCallTreeBottomUp(startingPoint, true, "_i");
     }
 }
\ No newline at end of file
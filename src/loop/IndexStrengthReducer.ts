@@ -0,0 +1,148 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { Expression, FunctionJp, Loop, Pragma, Vardecl, Varref, WrapperStmt } from "@specs-feup/clava/api/Joinpoints.js";
+import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { CountedLoop, LoopCharacterizer } from "./LoopCharacterizer.js";
+import { AffineForm, LoopNestAnalyzer, NestAccess } from "./LoopNestAnalyzer.js";
+
+type OffsetGroup = {
+    stride: number,
+    constant: number,
+    accesses: NestAccess[]
+}
+
+/**
+ * Replaces the flattened index expressions of innermost loops (e.g., a[i * 640 + j]) by running
+ * offsets, which are computed once before the loop and incremented by the stride of each iteration:
+ *
+ * int j_offset0 = i * 640 + 0;
+ * for (int j = 0; j < 640; j++, j_offset0 += 1) {
+ *     b[j_offset0] = a[j_offset0] + a[j_offset0 + 1];
+ * }
+ *
+ * Accesses whose subscripts differ only by a constant share the same offset. The increments are part of
+ * the step of the loop, so they also happen on a continue, and the induction variable itself is left as
+ * it was, so its value at the loop exit does not change. Only subscripts with a multiplication to save
+ * (a non-constant part besides the induction variable, or a non-unit stride) are rewritten.
+ *
+ * Loops with pragmas (e.g., #pragma omp for) are left as they are, since the extra increments break their
+ * canonical form and add a dependence between iterations. The rewritten step is kept as a literal, so the
+ * loop is no longer a counted loop (see LoopCharacterizer.getCountedLoop()) for later passes until a rebuild.
+ */
+export class IndexStrengthReducer extends AdvancedTransform {
+    private analyzer: LoopNestAnalyzer;
+    private characterizer: LoopCharacterizer;
+
+    constructor(silent: boolean = false) {
+        super("IndexStrengthReducer", silent);
+        this.analyzer = new LoopNestAnalyzer(true);
+        this.characterizer = new LoopCharacterizer(true);
+    }
+
+    /**
+     * @returns the number of loops whose index expressions were reduced
+     */
+    public reduceAllInFunction(fun: FunctionJp): number {
+        const innermost = Query.searchFrom(fun, Loop).get().filter((loop) => Query.searchFrom(loop.body, Loop).get().length == 0);
+
+        let cnt = 0;
+        for (const loop of innermost) {
+            if (this.reduce(loop) > 0) {
+                cnt++;
+            }
+        }
+        this.log(`Reduced the index expressions of ${cnt} of ${innermost.length} innermost loop(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    /**
+     * @returns the number of array accesses rewritten to use running offsets
+     */
+    public reduce(loop: Loop): number {
+        if (this.hasPragma(loop)) {
+            this.logDebug(() => `Loop at ${loop.location} has a pragma, not reducing its index expressions`);
+            return 0;
+        }
+        const counted = this.characterizer.getCountedLoop(loop);
+        if (counted == undefined) {
+            this.logDebug(() => `Loop at ${loop.location} is not a counted loop`);
+            return 0;
+        }
+        const groups = this.groupAccesses(counted);
+        if (groups.size == 0) {
+            return 0;
+        }
+        this.markDirty(loop);
+
+        const increments: string[] = [];
+        let rewritten = 0;
+        for (const group of groups.values()) {
+            const offset = this.declareOffset(counted, group.accesses[0]);
+            increments.push(`${offset.name} ${group.stride * counted.step > 0 ? "+=" : "-="} ${Math.abs(group.stride * counted.step)}`);
+
+            for (const access of group.accesses) {
+                const delta = (access.subscripts[0]!.get("") ?? 0) - group.constant;
+                const index = delta == 0 ?
+                    ClavaJoinPoints.varRef(offset) :
+                    ClavaJoinPoints.binaryOp(delta > 0 ? "+" : "-", ClavaJoinPoints.varRef(offset), ClavaJoinPoints.integerLiteral(Math.abs(delta)));
+                access.access.children[1].replaceWith(index);
+                rewritten++;
+            }
+        }
+        const step = loop.children[2].children[0];
+        step.replaceWith(ClavaJoinPoints.exprLiteral(`${step.code}, ${increments.join(", ")}`));
+
+        this.log(`Replaced ${rewritten} index expression(s) of the loop on ${counted.inductionVar} by ${groups.size} running offset(s)`);
+        return rewritten;
+    }
+
+    /**
+     * Groups the accesses worth reducing by their subscript without the constant term
+     */
+    private groupAccesses(counted: CountedLoop): Map<string, OffsetGroup> {
+        const iv = counted.inductionVar;
+        const groups = new Map<string, OffsetGroup>();
+
+        for (const access of this.analyzer.getAccesses(counted.loop.body)) {
+            const form = access.subscripts[0];
+            if (access.array == undefined || access.subscripts.length != 1 || form == undefined) {
+                continue;
+            }
+            const stride = this.analyzer.getStride(form, iv);
+            if (stride == undefined || stride == 0) {
+                continue;
+            }
+            const rest: AffineForm = new Map([...form].filter(([monomial]) => monomial != iv && monomial != ""));
+            const isInvariant = [...rest.keys()].every((monomial) =>
+                monomial.split("*").every((v) => !this.characterizer.isWrittenIn(counted.loop.body, v)));
+            if (!isInvariant || (rest.size == 0 && Math.abs(stride) == 1)) {
+                continue;
+            }
+
+            const key = `${this.analyzer.formToString(rest)} | ${stride}`;
+            const group = groups.get(key) ?? { stride: stride, constant: form.get("") ?? 0, accesses: [] };
+            group.accesses.push(access);
+            groups.set(key, group);
+        }
+        return groups;
+    }
+
+    /**
+     * Declares the offset before the loop, initialized with the subscript of the first iteration
+     */
+    private declareOffset(counted: CountedLoop, first: NestAccess): Vardecl {
+        const init = first.access.children[1].copy() as Expression;
+        for (const ref of Query.searchFrom(init, Varref, { name: counted.inductionVar }).get()) {
+            ref.replaceWith(ClavaJoinPoints.integerLiteral(counted.initialVal));
+        }
+        const offset = ClavaJoinPoints.varDecl(IdGenerator.next(`${counted.inductionVar}_offset`), init);
+        counted.loop.insertBefore(ClavaJoinPoints.declStmt(offset));
+        return offset;
+    }
+
+    private hasPragma(loop: Loop): boolean {
+        const left = loop.leftJp;
+        return left instanceof WrapperStmt && left.children[0] instanceof Pragma;
+    }
+}
@@ -1,4 +1,5 @@
-import { BinaryOp, IntLiteral, Loop, UnaryOp, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import { BinaryOp, IntLiteral, Joinpoint, Loop, UnaryOp, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
 
@@ -24,6 +25,72 @@ export class LoopCharacterizer extends AdvancedTransform {
         return characterization;
     }
 
+    /**
+     * Stricter than characterize(): only accepts for-loops of the form for (i = a; i < b; i += s), with
+     * literal a, b and s, any of <, <=, > and >= matching the direction of the step, and an induction
+     * variable that the body does not write to nor take the address of. The trip count is exact,
+     * which is what transforms that restructure the loop (e.g., unrolling) need.
+     */
+    public getCountedLoop(loop: Loop): CountedLoop | undefined {
+        if (loop.kind != "for" || loop.numChildren != 4) {
+            return undefined;
+        }
+        const ch = this.characterize(loop);
+        const iv = ch.inductionVar;
+        if (!ch.isValid || iv == "nil" || iv != ch.boundVar || iv != ch.incrementVar || (ch.op != "add" && ch.op != "sub") || ch.increment == 0) {
+            return undefined;
+        }
+
+        const init = loop.children[0].children[0];
+        const hasLiteralInit = (init instanceof Vardecl && init.numChildren == 1 && init.children[0] instanceof IntLiteral) ||
+            (init instanceof BinaryOp && init.kind == "assign" && init.right instanceof IntLiteral);
+        if (!hasLiteralInit) {
+            return undefined;
+        }
+
+        const cond = loop.children[1].children[0];
+        if (!(cond instanceof BinaryOp) || !(cond.left instanceof Varref) || !(cond.right instanceof IntLiteral)) {
+            return undefined;
+        }
+        const ascending = cond.kind == "lt" || cond.kind == "le";
+        const descending = cond.kind == "gt" || cond.kind == "ge";
+        if (!(ascending && ch.increment > 0) && !(descending && ch.increment < 0)) {
+            return undefined;
+        }
+        if (this.isWrittenIn(loop.body, iv)) {
+            return undefined;
+        }
+
+        // the characterization bound is already exclusive, e.g., i <= 9 has bound 10
+        const tripCount = Math.max(0, Math.ceil((ch.bound - ch.initialVal) / ch.increment));
+        return {
+            loop: loop,
+            inductionVar: iv,
+            initialVal: ch.initialVal,
+            step: ch.increment,
+            tripCount: tripCount,
+            declaresInductionVar: init instanceof Vardecl
+        };
+    }
+
+    /**
+     * Checks whether a variable is assigned, incremented, decremented, has its address taken,
+     * or is shadowed by another declaration inside a region
+     */
+    public isWrittenIn(region: Joinpoint, name: string): boolean {
+        for (const varref of Query.searchFrom(region, Varref, { name: name })) {
+            const parent = varref.parent;
+            if (parent instanceof UnaryOp && ["pre_inc", "post_inc", "pre_dec", "post_dec", "addr_of"].includes(parent.kind)) {
+                return true;
+            }
+            if (parent instanceof BinaryOp && parent.isAssignment && parent.left.astId === varref.astId) {
+                return true;
+            }
+        }
+        // a nested declaration with the same name would shadow it
+        return Query.searchFrom(region, Vardecl, { name: name }).get().length > 0;
+    }
+
     public annotate(loop: Loop, ch: LoopCharacterization, idiom: LoopAnnotationIdiom = LoopAnnotationIdiom.CLAVA): void {
         if (ch.isValid) {
             const max = ch.tripCount;
@@ -323,6 +390,20 @@ export class LoopCharacterizer extends AdvancedTransform {
     }
 }
 
+/**
+ * A for-loop whose iterations are known at compile time: the induction variable takes the values
+ * initialVal + k * step, for k from 0 to tripCount - 1
+ */
+export type CountedLoop = {
+    loop: Loop;
+    inductionVar: string;
+    initialVal: number;
+    step: number;
+    tripCount: number;
+    // whether it is declared in the init of the loop, and therefore not visible after it
+    declaresInductionVar: boolean;
+}
+
 export type LoopCharacterization = {
     isValid: boolean;
     inductionVar: string;
@@ -0,0 +1,153 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FunctionJp, Loop, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { CountedLoop } from "./LoopCharacterizer.js";
+import { AffineForm, LoopNestAnalyzer, NestAccess } from "./LoopNestAnalyzer.js";
+
+/**
+ * Collapses the innermost loops of a perfect nest into a single loop with a linear index, when
+ * each inner loop spans a full row of the flattened arrays it accesses, i.e., when the stride of
+ * every loop is the stride of the loop inside it times its trip count:
+ *
+ * for (int i = 0; i < 256; i++)
+ *     for (int j = 0; j < 256; j++)          =>     for (int i_j0 = 0; i_j0 < 65536; i_j0++)
+ *         frame[i * 256 + j] = 0;                        frame[i_j0] = 0;
+ *
+ * The collapsed loop runs the iterations in the same order, so no dependence check is needed, but the
+ * induction variables can only be used in the subscripts that are rewritten. Loops must count up by 1,
+ * and the nest cannot have breaks out of its loops, gotos or labels, since a break that ended a row
+ * would end the whole collapsed loop.
+ */
+export class LoopCollapser extends AdvancedTransform {
+    private analyzer: LoopNestAnalyzer;
+
+    constructor(silent: boolean = false) {
+        super("LoopCollapser", silent);
+        this.analyzer = new LoopNestAnalyzer(true);
+    }
+
+    /**
+     * @returns the number of nests that were collapsed
+     */
+    public collapseAllInFunction(fun: FunctionJp): number {
+        const outermost = Query.searchFrom(fun, Loop).get().filter((loop) => loop.getAncestor("loop") == undefined);
+
+        let cnt = 0;
+        for (const loop of outermost) {
+            if (this.collapse(loop) > 0) {
+                cnt++;
+            }
+        }
+        this.log(`Collapsed ${cnt} of ${outermost.length} loop nest(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    /**
+     * Collapses as many of the innermost loops of the perfect nest that starts at a loop as possible
+     * @returns the number of loops merged into one, or 0 if the nest was left as it was
+     */
+    public collapse(outer: Loop): number {
+        const nest = this.analyzer.getPerfectNest(outer);
+        if (nest == undefined || nest.length < 2) {
+            this.logDebug(() => `Loop at ${outer.location} is not a perfect nest of counted loops`);
+            return 0;
+        }
+        const exitReason = this.analyzer.checkEarlyExits(nest, true);
+        if (exitReason != undefined) {
+            this.logDebug(() => `Cannot collapse the nest at ${outer.location}: ${exitReason}`);
+            return 0;
+        }
+        const body = nest[nest.length - 1].loop.body;
+        const accesses = this.analyzer.getAccesses(body);
+
+        const first = this.findFirstCollapsible(nest, accesses);
+        if (first == nest.length - 1) {
+            this.logDebug(() => `Inner loops of the nest at ${outer.location} do not span full rows of the arrays`);
+            return 0;
+        }
+        const collapsed = nest.slice(first);
+        const ivs = collapsed.map((counted) => counted.inductionVar);
+        const rewritten = accesses.filter((access) => ivs.some((iv) => access.subscripts[0]?.has(iv)));
+
+        // e.g., out[i * 64 + j] = i; would need a division to get i back
+        const inSubscripts = new Set(rewritten.flatMap((access) => Query.searchFrom(access.access.children[1], Varref).get().map((ref) => ref.astId)));
+        if (Query.searchFrom(body, Varref).get().some((ref) => ivs.includes(ref.name) && !inSubscripts.has(ref.astId))) {
+            this.logDebug(() => `Cannot collapse the nest at ${outer.location}: induction variables are used outside of subscripts`);
+            return 0;
+        }
+
+        this.rewrite(collapsed, rewritten);
+        return collapsed.length;
+    }
+
+    /**
+     * @returns the level of the outermost loop that can be collapsed with all the loops inside it
+     */
+    private findFirstCollapsible(nest: CountedLoop[], accesses: NestAccess[]): number {
+        let first = nest.length - 1;
+        if (nest.some((counted) => counted.step != 1 || counted.tripCount == 0)) {
+            return first;
+        }
+
+        while (first > 0) {
+            const outer = nest[first - 1].inductionVar;
+            const inner = nest[first];
+            const spansRows = accesses.every((access) => {
+                const usesNest = nest.slice(first - 1).some((counted) => access.subscripts.some((form) => form == undefined || form.has(counted.inductionVar)));
+                if (!usesNest) {
+                    return true;
+                }
+                // only flattened accesses, since rows of multidimensional arrays may have padding
+                const form = access.subscripts[0];
+                if (access.subscripts.length != 1 || form == undefined) {
+                    return false;
+                }
+                const outerStride = this.analyzer.getStride(form, outer);
+                const innerStride = this.analyzer.getStride(form, inner.inductionVar);
+                return outerStride != undefined && innerStride != undefined && outerStride == innerStride * inner.tripCount;
+            });
+            if (!spansRows) {
+                break;
+            }
+            first--;
+        }
+        return first;
+    }
+
+    private rewrite(collapsed: CountedLoop[], rewritten: NestAccess[]): void {
+        const outerLoop = collapsed[0].loop;
+        const innerLoop = collapsed[collapsed.length - 1].loop;
+        const ivs = collapsed.map((counted) => counted.inductionVar);
+        this.markDirty(outerLoop);
+
+        // the linear index of the first iteration, with each loop weighted by the size of the loops inside it
+        let start = 0;
+        let tripCount = 1;
+        for (let level = collapsed.length - 1; level >= 0; level--) {
+            start += collapsed[level].initialVal * tripCount;
+            tripCount *= collapsed[level].tripCount;
+        }
+        const index = ClavaJoinPoints.varDecl(IdGenerator.next(ivs.join("_")), ClavaJoinPoints.integerLiteral(start));
+
+        for (const access of rewritten) {
+            const form = access.subscripts[0]!;
+            const stride = this.analyzer.getStride(form, ivs[ivs.length - 1])!;
+            const linear: AffineForm = new Map([[index.name, stride], ...[...form].filter(([monomial]) => !ivs.includes(monomial))]);
+            access.access.children[1].replaceWith(ClavaJoinPoints.exprLiteral(this.analyzer.formToString(linear)));
+        }
+
+        for (const stmt of innerLoop.body.children) {
+            collapsed[1].loop.insertBefore(stmt.detach());
+        }
+        collapsed[1].loop.detach();
+
+        outerLoop.children[0].replaceWith(ClavaJoinPoints.declStmt(index));
+        outerLoop.children[1].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${index.name} < ${start + tripCount}`));
+        outerLoop.children[2].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${index.name}++`));
+
+        this.analyzer.restoreFinalValues(collapsed, outerLoop);
+        this.log(`Collapsed the loops on ${ivs.join(", ")} into a single loop with ${tripCount} iterations`);
+    }
+}
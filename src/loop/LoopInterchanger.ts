@@ -0,0 +1,136 @@
+import { FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { CountedLoop } from "./LoopCharacterizer.js";
+import { LoopNestAnalyzer, NestAccess } from "./LoopNestAnalyzer.js";
+
+// stands for strides that are not known at compile time, e.g., i * cols
+const UNKNOWN_STRIDE = 2 ** 31;
+
+/**
+ * Reorders the loops of perfect nests so that the innermost loop walks the arrays with unit stride,
+ * e.g., turning the column-major walk of a flattened matrix into a row-major one:
+ *
+ * for (int j = 0; j < 64; j++)             for (int i = 0; i < 32; i++)
+ *     for (int i = 0; i < 32; i++)    =>       for (int j = 0; j < 64; j++)
+ *         b[i * 64 + j] = a[i * 64 + j];           b[i * 64 + j] = a[i * 64 + j];
+ *
+ * The loops are sorted by how many accesses they make with a non-unit stride, and then by the sum of
+ * their strides, from the outermost inwards. The nest is only changed if the new innermost loop has
+ * fewer non-unit accesses, and if it is fully permutable (see LoopNestAnalyzer.checkReordering()).
+ * The loop headers are swapped, so the body is left untouched.
+ */
+export class LoopInterchanger extends AdvancedTransform {
+    private analyzer: LoopNestAnalyzer;
+
+    constructor(silent: boolean = false) {
+        super("LoopInterchanger", silent);
+        this.analyzer = new LoopNestAnalyzer(true);
+    }
+
+    /**
+     * @returns the number of nests that were interchanged
+     */
+    public interchangeAllInFunction(fun: FunctionJp): number {
+        const outermost = Query.searchFrom(fun, Loop).get().filter((loop) => loop.getAncestor("loop") == undefined);
+
+        let cnt = 0;
+        for (const loop of outermost) {
+            if (this.interchange(loop)) {
+                cnt++;
+            }
+        }
+        this.log(`Interchanged ${cnt} of ${outermost.length} loop nest(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    /**
+     * @returns whether the loops of the perfect nest that starts at the given loop were reordered
+     */
+    public interchange(outer: Loop): boolean {
+        const nest = this.analyzer.getPerfectNest(outer);
+        if (nest == undefined || nest.length < 2) {
+            this.logDebug(() => `Loop at ${outer.location} is not a perfect nest of counted loops`);
+            return false;
+        }
+        const order = this.getBestOrder(nest);
+        const innermost = nest.length - 1;
+        if (order[innermost] == innermost || this.countNonUnit(nest[order[innermost]], nest) >= this.countNonUnit(nest[innermost], nest)) {
+            this.logDebug(() => `Loop nest at ${outer.location} already has the best innermost loop`);
+            return false;
+        }
+
+        const reason = nest.some((counted) => counted.tripCount == 0) ? "nest has a loop without iterations" : this.analyzer.checkReordering(nest);
+        if (reason != undefined) {
+            this.logDebug(() => `Cannot interchange loop nest at ${outer.location}: ${reason}`);
+            return false;
+        }
+
+        this.permute(nest, order);
+        this.log(`Interchanged loop nest on ${nest.map((counted) => counted.inductionVar).join(", ")} into ${order.map((i) => nest[i].inductionVar).join(", ")}`);
+        return true;
+    }
+
+    /**
+     * @returns the indexes of the loops of the nest in their new order, from the outermost inwards
+     */
+    public getBestOrder(nest: CountedLoop[]): number[] {
+        const costs = nest.map((counted) => [this.countNonUnit(counted, nest), this.sumStrides(counted, nest)]);
+
+        // the stable sort keeps the original order of loops with the same costs
+        return nest.map((_, i) => i).sort((a, b) => (costs[b][0] - costs[a][0]) || (costs[b][1] - costs[a][1]));
+    }
+
+    /**
+     * Number of accesses in the nest that a loop moves by anything but 0 or 1 elements
+     */
+    private countNonUnit(counted: CountedLoop, nest: CountedLoop[]): number {
+        return this.getAccesses(nest).filter((access) => {
+            const stride = this.getAccessStride(access, counted.inductionVar);
+            return stride != 0 && Math.abs(stride) != 1;
+        }).length;
+    }
+
+    private sumStrides(counted: CountedLoop, nest: CountedLoop[]): number {
+        return this.getAccesses(nest).reduce((acc, access) => acc + Math.abs(this.getAccessStride(access, counted.inductionVar)), 0);
+    }
+
+    /**
+     * The stride of a loop in an access, in elements. Subscripts before the last one move by whole rows,
+     * whose size is not known here, so they count as unknown strides.
+     */
+    private getAccessStride(access: NestAccess, iv: string): number {
+        let stride = 0;
+        for (let i = 0; i < access.subscripts.length; i++) {
+            const form = access.subscripts[i];
+            const inDim = form == undefined ? undefined : this.analyzer.getStride(form, iv);
+            if (inDim == undefined) {
+                return UNKNOWN_STRIDE;
+            }
+            if (inDim != 0) {
+                stride += i == access.subscripts.length - 1 ? inDim : UNKNOWN_STRIDE;
+            }
+        }
+        return stride;
+    }
+
+    private getAccesses(nest: CountedLoop[]): NestAccess[] {
+        return this.analyzer.getAccesses(nest[nest.length - 1].loop.body);
+    }
+
+    /**
+     * Since the bounds of every loop are literals, reordering the nest only requires moving the headers
+     */
+    private permute(nest: CountedLoop[], order: number[]): void {
+        const headers = nest.map((counted) => counted.loop.children.slice(0, 3).map((stmt) => stmt.copy()));
+
+        for (let level = 0; level < nest.length; level++) {
+            const loop = nest[level].loop;
+            const header = headers[order[level]];
+            for (let k = 0; k < 3; k++) {
+                loop.children[k].replaceWith(header[k].copy());
+            }
+        }
+        this.markDirty(nest[0].loop);
+    }
+}
@@ -0,0 +1,395 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { ArrayAccess, BinaryOp, Call, Cast, Expression, ExprLiteral, GotoStmt, IntLiteral, Joinpoint, LabelStmt, Loop, Param, ParenExpr, QualType, ReturnStmt, Statement, Switch, UnaryOp, Vardecl, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { CountedLoop, LoopCharacterizer } from "./LoopCharacterizer.js";
+
+/**
+ * A subscript as a sum of monomials, each with an integer coefficient. A monomial is the product of
+ * its variables, sorted and joined by "*", and the constant term is the empty monomial.
+ * E.g., i * 640 + j + 1 is {"i" => 640, "j" => 1, "" => 1}.
+ */
+export type AffineForm = Map<string, number>;
+
+/**
+ * An outermost array access, e.g., A[i][j] rather than A[i], with one form per subscript
+ * (outermost dimension first), which is undefined for subscripts that are not polynomials
+ */
+export type NestAccess = {
+    access: ArrayAccess,
+    array: string | undefined,
+    // declaration of the array, if it is a named one
+    decl: Vardecl | undefined,
+    subscripts: (AffineForm | undefined)[],
+    isWrite: boolean
+}
+
+/**
+ * Analyses perfectly nested counted loops (see LoopCharacterizer.getCountedLoop()) and the subscripts
+ * of the array accesses in them, which after ArrayFlattener make the strides of each loop explicit
+ * (e.g., A[i * cols + j]). It is the basis of the loop transforms that reorder iterations (tiling,
+ * interchange, collapsing) and of the strength reduction of flattened index expressions.
+ *
+ * The dependence check is conservative: written arrays must be local arrays or restrict pointers that
+ * are only used through subscripts, so that no other name (or pointer arithmetic) can reach their elements.
+ */
+export class LoopNestAnalyzer extends AdvancedTransform {
+    private characterizer: LoopCharacterizer;
+
+    constructor(silent: boolean = false) {
+        super("LoopNestAnalyzer", silent);
+        this.characterizer = new LoopCharacterizer(true);
+    }
+
+    public getCountedLoop(loop: Loop): CountedLoop | undefined {
+        return this.characterizer.getCountedLoop(loop);
+    }
+
+    /**
+     * Collects the counted loops of a perfect nest, from the outermost inwards: each loop but the
+     * innermost has a body with that loop and nothing else.
+     * @param maxDepth stops at this many loops, even if the nest is deeper
+     * @returns undefined if the outer loop is not a counted loop
+     */
+    public getPerfectNest(outer: Loop, maxDepth: number = Infinity): CountedLoop[] | undefined {
+        const nest: CountedLoop[] = [];
+        let loop: Loop | undefined = outer;
+
+        while (loop != undefined && nest.length < maxDepth) {
+            const counted = this.getCountedLoop(loop);
+            if (counted == undefined) {
+                break;
+            }
+            nest.push(counted);
+            const stmts = loop.body.children;
+            loop = stmts.length == 1 && stmts[0] instanceof Loop ? stmts[0] : undefined;
+        }
+        return nest.length > 0 ? nest : undefined;
+    }
+
+    /**
+     * @returns undefined if the expression is not a polynomial of variables and integer literals
+     */
+    public toAffine(expr: Joinpoint): AffineForm | undefined {
+        if (expr instanceof IntLiteral) {
+            return new Map([["", Number(expr.value)]]);
+        }
+        if (expr instanceof Varref) {
+            return new Map([[expr.name, 1]]);
+        }
+        if (expr instanceof ParenExpr || expr instanceof Cast) {
+            return this.toAffine(expr.children[0]);
+        }
+        if (expr instanceof UnaryOp && (expr.kind == "minus" || expr.kind == "plus")) {
+            const operand = this.toAffine(expr.children[0]);
+            return operand == undefined ? undefined : this.scale(operand, expr.kind == "minus" ? -1 : 1);
+        }
+        if (!(expr instanceof BinaryOp) || !["add", "sub", "mul"].includes(expr.kind)) {
+            return undefined;
+        }
+        const left = this.toAffine(expr.left);
+        const right = this.toAffine(expr.right);
+        if (left == undefined || right == undefined) {
+            return undefined;
+        }
+        if (expr.kind == "mul") {
+            return this.multiply(left, right);
+        }
+        return this.add(left, expr.kind == "add" ? right : this.scale(right, -1));
+    }
+
+    /**
+     * The numeric coefficient of a variable, i.e., how much the subscript changes when it is incremented
+     * @returns 0 if the subscript does not use it, and undefined if it is multiplied by other variables
+     */
+    public getStride(form: AffineForm, name: string): number | undefined {
+        let stride = 0;
+        for (const [monomial, coef] of form) {
+            if (monomial == name) {
+                stride = coef;
+            }
+            else if (monomial.split("*").includes(name)) {
+                return undefined;
+            }
+        }
+        return stride;
+    }
+
+    public formsEqual(a: AffineForm, b: AffineForm): boolean {
+        return a.size == b.size && [...a].every(([monomial, coef]) => b.get(monomial) === coef);
+    }
+
+    public formToString(form: AffineForm): string {
+        const terms = [...form].map(([monomial, coef]) => {
+            if (monomial == "") {
+                return `${coef}`;
+            }
+            return coef == 1 ? monomial : `${monomial} * ${coef}`;
+        });
+        return terms.length == 0 ? "0" : terms.join(" + ").replace(/\+ -/g, "- ");
+    }
+
+    public getAccesses(region: Joinpoint): NestAccess[] {
+        const accesses: NestAccess[] = [];
+
+        for (const access of Query.searchFrom(region, ArrayAccess)) {
+            if (access.parent instanceof ArrayAccess && access.parent.children[0].astId === access.astId) {
+                continue;
+            }
+            const subscripts: (AffineForm | undefined)[] = [];
+            let base: Joinpoint = access;
+            while (base instanceof ArrayAccess) {
+                subscripts.unshift(this.toAffine(base.children[1]));
+                base = base.children[0];
+            }
+            accesses.push({
+                access: access,
+                array: base instanceof Varref ? base.name : undefined,
+                decl: base instanceof Varref ? base.vardecl : undefined,
+                subscripts: subscripts,
+                isWrite: this.isWritten(access)
+            });
+        }
+        return accesses;
+    }
+
+    /**
+     * Checks whether the iterations of a perfect nest can be executed in any order that keeps each
+     * loop in its original direction, i.e., whether the nest is fully permutable, which makes both
+     * tiling and any interchange of its loops legal. Every element of a written array must be
+     * accessed through the same subscripts, which must map different iterations to different
+     * elements, except along at most one loop, whose order is kept by any permutation. The nest must
+     * also run all of its iterations (see checkEarlyExits()).
+     * @returns why the nest cannot be reordered, or undefined if it can
+     */
+    public checkReordering(nest: CountedLoop[]): string | undefined {
+        const region = nest[0].loop.body;
+        const ivs = new Set(nest.map((counted) => counted.inductionVar));
+
+        if (Query.searchFrom(region, Call).get().length > 0) {
+            return "nest has function calls";
+        }
+        if (Query.searchFrom(region, ExprLiteral).get().length > 0) {
+            return "nest has code that was not parsed (e.g., it was flattened without a rebuild)";
+        }
+        const exitReason = this.checkEarlyExits(nest);
+        if (exitReason != undefined) {
+            return exitReason;
+        }
+        const scalarReason = this.checkScalarWrites(region, ivs);
+        if (scalarReason != undefined) {
+            return scalarReason;
+        }
+
+        const spans = new Map(nest.map((counted) => [counted.inductionVar, (counted.tripCount - 1) * Math.abs(counted.step)]));
+        const accesses = this.getAccesses(region);
+
+        for (const write of accesses.filter((acc) => acc.isWrite)) {
+            if (write.array == undefined) {
+                return "nest writes through an array access that is not on a named array";
+            }
+            const aliasReason = this.checkAliasing(write, region);
+            if (aliasReason != undefined) {
+                return aliasReason;
+            }
+            if (write.subscripts.some((form) => form == undefined)) {
+                return `array ${write.array} is written with subscripts that could not be analysed`;
+            }
+            const others = accesses.filter((acc) => acc.array == write.array);
+            const sameSubscripts = others.every((acc) => acc.subscripts.length == write.subscripts.length &&
+                acc.subscripts.every((form, i) => form != undefined && this.formsEqual(form, write.subscripts[i]!)));
+            if (!sameSubscripts) {
+                return `array ${write.array} is written and accessed with different subscripts`;
+            }
+
+            for (const form of write.subscripts) {
+                for (const [monomial] of form!) {
+                    const vars = monomial == "" ? [] : monomial.split("*");
+                    if (vars.some((v) => ivs.has(v)) && vars.length > 1) {
+                        return `subscript of ${write.array} has a non-constant stride`;
+                    }
+                    if (vars.some((v) => !ivs.has(v) && this.characterizer.isWrittenIn(region, v))) {
+                        return `subscript of ${write.array} uses a variable written in the nest`;
+                    }
+                }
+            }
+            const reason = this.checkInjective(write, nest, spans);
+            if (reason != undefined) {
+                return reason;
+            }
+        }
+        return undefined;
+    }
+
+    /**
+     * Checks for control flow that leaves the nest, or one of its loops, before its last iteration:
+     * labels, gotos, breaks out of a loop of the nest (breaks of loops and switches inside the
+     * innermost body are fine) and, unless allowed, returns. Continues only end the current iteration.
+     * @returns the first such statement found, or undefined if there is none
+     */
+    public checkEarlyExits(nest: CountedLoop[], allowReturns: boolean = false): string | undefined {
+        const region = nest[0].loop.body;
+        const nestLoops = new Set(nest.map((counted) => counted.loop.astId));
+
+        if (Query.searchFrom(region, LabelStmt).get().length > 0 || Query.searchFrom(region, GotoStmt).get().length > 0) {
+            return "nest has labels or gotos";
+        }
+        if (!allowReturns && Query.searchFrom(region, ReturnStmt).get().length > 0) {
+            return "nest has a return";
+        }
+        for (const stmt of Query.searchFrom(region, Statement)) {
+            if (!AstPredicates.isBreak(stmt)) {
+                continue;
+            }
+            let parent = stmt.parent;
+            while (!(parent instanceof Loop) && !(parent instanceof Switch)) {
+                parent = parent.parent;
+            }
+            if (nestLoops.has(parent.astId)) {
+                return "nest has a break out of one of its loops";
+            }
+        }
+        return undefined;
+    }
+
+    /**
+     * Induction variables declared outside a transformed nest must keep the values they had after the
+     * original one, so an assignment of each final value is inserted after the given statement
+     * @returns the last statement inserted, or the given one if there was nothing to restore
+     */
+    public restoreFinalValues(nest: CountedLoop[], after: Statement): Statement {
+        let last = after;
+        for (const counted of nest.filter((counted) => !counted.declaresInductionVar)) {
+            const value = counted.initialVal + counted.tripCount * counted.step;
+            last = last.insertAfter(ClavaJoinPoints.stmtLiteral(`${counted.inductionVar} = ${value};`)) as Statement;
+        }
+        return last;
+    }
+
+    /**
+     * A written array can only be reordered if its elements cannot be reached by other names: it must be
+     * a local array, only ever used through subscripts in its function, or a restrict pointer, only used
+     * through subscripts in the nest (e.g., no *(a + k) or pointer copies)
+     */
+    private checkAliasing(write: NestAccess, region: Joinpoint): string | undefined {
+        const decl = write.decl;
+        if (decl == undefined) {
+            return `array ${write.array} has no visible declaration`;
+        }
+        const isLocalArray = decl.type.isArray && !decl.isGlobal && !(decl instanceof Param);
+        if (!isLocalArray && !this.isRestrict(decl)) {
+            return `array ${write.array} may alias other arrays (it is neither a local array nor restrict)`;
+        }
+
+        const scope = isLocalArray ? decl.getAncestor("function") ?? region : region;
+        for (const ref of Query.searchFrom(scope, Varref, { name: decl.name })) {
+            const isBase = ref.parent instanceof ArrayAccess && ref.parent.children[0].astId === ref.astId;
+            if (!isBase) {
+                return `array ${write.array} is used without a subscript, and may be accessed through other pointers`;
+            }
+        }
+        return undefined;
+    }
+
+    private isRestrict(decl: Vardecl): boolean {
+        const type = decl.type.desugarAll;
+        return type instanceof QualType && type.qualifiers.some((qualifier) => qualifier.includes("restrict"));
+    }
+
+    private checkInjective(write: NestAccess, nest: CountedLoop[], spans: Map<string, number>): string | undefined {
+        const used = new Set<string>();
+
+        for (const form of write.subscripts) {
+            const terms = [...form!].filter(([monomial]) => spans.has(monomial) && spans.get(monomial)! > 0);
+            if (terms.some(([monomial]) => used.has(monomial))) {
+                return `subscripts of ${write.array} share induction variables`;
+            }
+            terms.forEach(([monomial]) => used.add(monomial));
+
+            // mixed radix: each coefficient must be larger than everything the smaller ones can add up to
+            terms.sort((a, b) => Math.abs(a[1]) - Math.abs(b[1]));
+            let reach = 0;
+            for (const [monomial, coef] of terms) {
+                if (Math.abs(coef) <= reach) {
+                    return `subscripts of ${write.array} may access the same element in different iterations`;
+                }
+                reach += Math.abs(coef) * spans.get(monomial)!;
+            }
+        }
+
+        // iterations that only differ in the loops the subscripts do not use write the same element
+        const unused = nest.filter((counted) => !used.has(counted.inductionVar) && counted.tripCount > 1);
+        if (unused.length > 1) {
+            return `array ${write.array} is written in the same position across loops ${unused.map((counted) => counted.inductionVar).join(", ")}`;
+        }
+        return undefined;
+    }
+
+    /**
+     * Scalars written in the nest must be declared in it, or else they carry values across iterations
+     */
+    private checkScalarWrites(region: Joinpoint, ivs: Set<string>): string | undefined {
+        const declared = new Set(Query.searchFrom(region, Vardecl).get().map((decl) => decl.name));
+
+        for (const expr of Query.searchFrom(region, Expression)) {
+            let target: Joinpoint | undefined = undefined;
+            if (expr instanceof BinaryOp && expr.isAssignment) {
+                target = expr.left;
+            }
+            else if (expr instanceof UnaryOp && ["pre_inc", "post_inc", "pre_dec", "post_dec", "addr_of"].includes(expr.kind)) {
+                target = expr.children[0];
+            }
+            if (target == undefined || target instanceof ArrayAccess) {
+                continue;
+            }
+            if (!(target instanceof Varref)) {
+                return `nest writes to ${target.code}`;
+            }
+            if (!declared.has(target.name) && !ivs.has(target.name)) {
+                return `nest writes to variable ${target.name}, declared outside of it`;
+            }
+        }
+        return undefined;
+    }
+
+    private isWritten(access: ArrayAccess): boolean {
+        const parent = access.parent;
+        if (parent instanceof BinaryOp && parent.isAssignment && parent.left.astId === access.astId) {
+            return true;
+        }
+        return parent instanceof UnaryOp && ["pre_inc", "post_inc", "pre_dec", "post_dec", "addr_of"].includes(parent.kind);
+    }
+
+    private add(a: AffineForm, b: AffineForm): AffineForm {
+        const sum = new Map(a);
+        for (const [monomial, coef] of b) {
+            sum.set(monomial, (sum.get(monomial) ?? 0) + coef);
+        }
+        return this.dropZeros(sum);
+    }
+
+    private scale(form: AffineForm, factor: number): AffineForm {
+        return this.dropZeros(new Map([...form].map(([monomial, coef]) => [monomial, coef * factor])));
+    }
+
+    private multiply(a: AffineForm, b: AffineForm): AffineForm {
+        const product: AffineForm = new Map();
+        for (const [ma, ca] of a) {
+            for (const [mb, cb] of b) {
+                const monomial = [...ma.split("*"), ...mb.split("*")].filter((v) => v != "").sort().join("*");
+                product.set(monomial, (product.get(monomial) ?? 0) + ca * cb);
+            }
+        }
+        return this.dropZeros(product);
+    }
+
+    private dropZeros(form: AffineForm): AffineForm {
+        for (const [monomial, coef] of form) {
+            if (coef == 0) {
+                form.delete(monomial);
+            }
+        }
+        return form;
+    }
+}
@@ -0,0 +1,162 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { BinaryOp, FunctionJp, Loop, Pragma, Statement, Vardecl, WrapperStmt } from "@specs-feup/clava/api/Joinpoints.js";
+import IdGenerator from "@specs-feup/lara/api/lara/util/IdGenerator.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { CountedLoop } from "./LoopCharacterizer.js";
+import { LoopNestAnalyzer } from "./LoopNestAnalyzer.js";
+
+export type LoopTilerOptions = {
+    // tile size of each loop of the nest, from the outermost inwards; also sets how many loops are tiled
+    tileSizes?: number[],
+    // loops with fewer iterations than this are not worth tiling, and are left as they are
+    minTripCount?: number
+}
+
+/**
+ * Tiles (or blocks) perfect nests of counted loops, so that each tile of the iteration space works on
+ * a block of the arrays that fits in the cache. Each loop is split into a tile loop, which steps over
+ * the blocks, and a point loop inside all tile loops, which goes over the iterations of a block:
+ *
+ * for (int i_tile = 0; i_tile < N; i_tile += TI)
+ *     for (int j_tile = 0; j_tile < M; j_tile += TJ)
+ *         for (int i = i_tile; i < (i_tile + TI < N ? i_tile + TI : N); i++)
+ *             for (int j = j_tile; ...
+ *
+ * The point loops only clamp their bound when the tile size does not divide the trip count.
+ * Nests are only tiled if they are fully permutable (see LoopNestAnalyzer.checkReordering()).
+ */
+export class LoopTiler extends AdvancedTransform {
+    private options: Required<LoopTilerOptions>;
+    private analyzer: LoopNestAnalyzer;
+
+    constructor(options: LoopTilerOptions = {}, silent: boolean = false) {
+        super("LoopTiler", silent);
+        this.options = {
+            tileSizes: [32, 32],
+            minTripCount: 2,
+            ...options
+        };
+        this.analyzer = new LoopNestAnalyzer(true);
+    }
+
+    /**
+     * Tiles the nests annotated with "#pragma clava tile T1 T2 ...", with the sizes of the pragma,
+     * and removes the pragmas of the nests that were tiled
+     * @returns the number of nests tiled
+     */
+    public tileAnnotatedInFunction(fun: FunctionJp): number {
+        let cnt = 0;
+        for (const pragma of Query.searchFrom(fun, Pragma, (p) => p.name == "clava" && /^tile\b/.test(p.content.trim())).get()) {
+            const wrapper = pragma.parent as WrapperStmt;
+            const loop = wrapper.rightJp;
+            const sizes = pragma.content.trim().split(/\s+/).slice(1).map(Number);
+
+            if (!(loop instanceof Loop) || sizes.length == 0 || sizes.some((size) => !Number.isInteger(size) || size < 1)) {
+                this.logWarning(`Ignoring malformed tile pragma at ${pragma.location}: "${pragma.code}"`);
+                continue;
+            }
+            if (this.tile(loop, sizes)) {
+                wrapper.detach();
+                cnt++;
+            }
+        }
+        this.log(`Tiled ${cnt} annotated loop nest(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    /**
+     * Tiles every outermost loop nest that is deep enough for the tile sizes of the options
+     * @returns the number of nests tiled
+     */
+    public tileAllInFunction(fun: FunctionJp): number {
+        const outermost = Query.searchFrom(fun, Loop).get().filter((loop) => loop.getAncestor("loop") == undefined);
+
+        let cnt = 0;
+        for (const loop of outermost) {
+            if (this.tile(loop, this.options.tileSizes)) {
+                cnt++;
+            }
+        }
+        this.log(`Tiled ${cnt} of ${outermost.length} loop nest(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    /**
+     * Tiles the first tileSizes.length loops of the perfect nest that starts at a loop
+     * @returns whether the nest was tiled
+     */
+    public tile(outer: Loop, tileSizes: number[] = this.options.tileSizes): boolean {
+        const nest = this.analyzer.getPerfectNest(outer, tileSizes.length);
+        if (nest == undefined || nest.length < tileSizes.length) {
+            this.logDebug(() => `Loop at ${outer.location} is not a perfect nest of ${tileSizes.length} counted loops`);
+            return false;
+        }
+        const reason = this.getRejectionReason(nest);
+        if (reason != undefined) {
+            this.logDebug(() => `Cannot tile loop nest at ${outer.location}: ${reason}`);
+            return false;
+        }
+
+        this.markDirty(outer);
+        const tileLoops = nest.map((counted, i) => this.makeTileLoop(counted, tileSizes[i]));
+
+        outer.insertBefore(tileLoops[0]);
+        for (let i = 1; i < tileLoops.length; i++) {
+            tileLoops[i - 1].body.insertEnd(tileLoops[i]);
+        }
+        tileLoops[tileLoops.length - 1].body.insertEnd(outer.detach() as Statement);
+
+        this.analyzer.restoreFinalValues(nest, tileLoops[0]);
+
+        this.log(`Tiled loop nest on ${nest.map((counted) => counted.inductionVar).join(", ")} with tiles of ${tileSizes.join(" x ")}`);
+        return true;
+    }
+
+    private getRejectionReason(nest: CountedLoop[]): string | undefined {
+        for (const counted of nest) {
+            if (counted.step != 1) {
+                return `loop on ${counted.inductionVar} does not count up by 1`;
+            }
+            if (counted.tripCount < this.options.minTripCount) {
+                return `loop on ${counted.inductionVar} has only ${counted.tripCount} iteration(s)`;
+            }
+        }
+        // the point loops of the other dimensions run in between, so every loop of the nest must be reorderable
+        const fullNest = this.analyzer.getPerfectNest(nest[0].loop)!;
+        return this.analyzer.checkReordering(fullNest);
+    }
+
+    /**
+     * Builds the tile loop out of a copy of the original loop, and then turns the original into the point loop
+     */
+    private makeTileLoop(counted: CountedLoop, size: number): Loop {
+        const loop = counted.loop;
+        const iv = counted.inductionVar;
+        const end = this.getEnd(counted);
+
+        const tileVar = ClavaJoinPoints.varDecl(IdGenerator.next(`${iv}_tile`), ClavaJoinPoints.integerLiteral(counted.initialVal));
+        const tileLoop = loop.copy() as Loop;
+        tileLoop.body.children.forEach((stmt) => stmt.detach());
+        tileLoop.children[0].replaceWith(ClavaJoinPoints.declStmt(tileVar));
+        tileLoop.children[1].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${tileVar.name} < ${end}`));
+        tileLoop.children[2].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${tileVar.name} += ${size}`));
+
+        const init = loop.children[0].children[0];
+        if (init instanceof Vardecl) {
+            init.children[0].replaceWith(ClavaJoinPoints.varRef(tileVar));
+        }
+        else {
+            (init as BinaryOp).right.replaceWith(ClavaJoinPoints.varRef(tileVar));
+        }
+        const tileEnd = `${tileVar.name} + ${size}`;
+        const limit = counted.tripCount % size == 0 ? tileEnd : `(${tileEnd} < ${end} ? ${tileEnd} : ${end})`;
+        loop.children[1].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${iv} < ${limit}`));
+
+        return tileLoop;
+    }
+
+    private getEnd(counted: CountedLoop): number {
+        return counted.initialVal + counted.tripCount * counted.step;
+    }
+}
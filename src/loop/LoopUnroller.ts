@@ -0,0 +1,197 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { BinaryOp, Expression, FunctionJp, GotoStmt, LabelStmt, Loop, Scope, Statement, Switch, Varref } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { CountedLoop, LoopCharacterizer } from "./LoopCharacterizer.js";
+import { LoopNestAnalyzer } from "./LoopNestAnalyzer.js";
+
+export enum UnrollKind {
+    NONE = "none",
+    FULL = "full",
+    PARTIAL = "partial"
+}
+
+export type LoopUnrollerOptions = {
+    // loops with up to this many iterations are fully unrolled
+    maxFullTripCount?: number,
+    // unroll factor for the other loops with a known trip count; 1 disables partial unrolling
+    factor?: number,
+    // maximum number of statements in the unrolled code, to keep code size in check
+    maxUnrolledStatements?: number
+}
+
+/**
+ * Unrolls for-loops with a trip count known at compile time (see LoopCharacterizer.getCountedLoop()).
+ * Small loops are fully unrolled, and the others are unrolled by a factor, with the remaining iterations
+ * unrolled after the loop. Each iteration is a copy of the body in its own scope, where the induction
+ * variable is replaced by a literal (or by i + k, inside a partially unrolled loop), so that constant
+ * folding can then simplify the index expressions. ScopeFlattener removes the extra scopes.
+ */
+export class LoopUnroller extends AdvancedTransform {
+    private options: Required<LoopUnrollerOptions>;
+    private characterizer: LoopCharacterizer;
+    private analyzer: LoopNestAnalyzer;
+
+    constructor(options: LoopUnrollerOptions = {}, silent: boolean = false) {
+        super("LoopUnroller", silent);
+        this.options = {
+            maxFullTripCount: 8,
+            factor: 4,
+            maxUnrolledStatements: 256,
+            ...options
+        };
+        this.characterizer = new LoopCharacterizer(true);
+        this.analyzer = new LoopNestAnalyzer(true);
+    }
+
+    /**
+     * @param innermostOnly only unrolls loops without other loops inside, which are usually the hottest ones
+     * @returns the number of loops unrolled
+     */
+    public unrollAllInFunction(fun: FunctionJp, innermostOnly: boolean = true): number {
+        const loops = Query.searchFrom(fun, Loop).get()
+            .filter((loop) => !innermostOnly || Query.searchFrom(loop.body, Loop).get().length == 0);
+        // inner loops first, so that the copies of an outer body already have them unrolled
+        loops.sort((a, b) => this.getDepth(b) - this.getDepth(a));
+
+        let cnt = 0;
+        for (const loop of loops) {
+            if (this.unroll(loop) != UnrollKind.NONE) {
+                cnt++;
+            }
+        }
+        this.log(`Unrolled ${cnt} of ${loops.length} loop(s) in function ${fun.name}`);
+        return cnt;
+    }
+
+    public unroll(loop: Loop): UnrollKind {
+        const counted = this.characterizer.getCountedLoop(loop);
+        if (counted == undefined) {
+            this.logDebug(() => `Loop at ${loop.location} does not have a known trip count`);
+            return UnrollKind.NONE;
+        }
+        const reason = this.getRejectionReason(loop);
+        if (reason != undefined) {
+            this.logDebug(() => `Cannot unroll loop at ${loop.location}: ${reason}`);
+            return UnrollKind.NONE;
+        }
+
+        const bodySize = Query.searchFrom(loop.body, Statement).get().length;
+        const factor = this.options.factor;
+
+        if (counted.tripCount <= this.options.maxFullTripCount && bodySize * counted.tripCount <= this.options.maxUnrolledStatements) {
+            this.fullyUnroll(counted);
+            return UnrollKind.FULL;
+        }
+        // the remainder has at most factor - 1 more copies
+        if (factor > 1 && counted.tripCount >= factor && bodySize * (2 * factor - 1) <= this.options.maxUnrolledStatements) {
+            this.partiallyUnroll(counted, factor);
+            return UnrollKind.PARTIAL;
+        }
+        return UnrollKind.NONE;
+    }
+
+    /**
+     * Replaces the loop by one copy of its body per iteration
+     */
+    public fullyUnroll(counted: CountedLoop): void {
+        const loop = counted.loop;
+        this.markDirty(loop);
+
+        for (let k = 0; k < counted.tripCount; k++) {
+            const value = counted.initialVal + k * counted.step;
+            this.insertIteration(counted, loop.body, (copy) => loop.insertBefore(copy), () => ClavaJoinPoints.integerLiteral(value));
+        }
+        this.analyzer.restoreFinalValues([counted], loop);
+
+        this.log(`Fully unrolled loop on ${counted.inductionVar} with ${counted.tripCount} iterations`);
+        loop.detach();
+    }
+
+    /**
+     * Puts factor copies of the body in each iteration of the loop, and the remaining iterations after it
+     */
+    public partiallyUnroll(counted: CountedLoop, factor: number): void {
+        const loop = counted.loop;
+        const iterations = counted.tripCount - counted.tripCount % factor;
+        const template = loop.body.copy() as Scope;
+        const originalStmts = loop.body.children;
+        this.markDirty(loop);
+
+        for (let k = 0; k < factor; k++) {
+            const offset = k * counted.step;
+            this.insertIteration(counted, template, (copy) => loop.body.insertEnd(copy), (ref) => offset == 0 ?
+                ref.copy() as Expression :
+                ClavaJoinPoints.parenthesis(ClavaJoinPoints.binaryOp(offset > 0 ? "+" : "-", ref.copy() as Expression, ClavaJoinPoints.integerLiteral(Math.abs(offset)))));
+        }
+        originalStmts.forEach((stmt) => stmt.detach());
+
+        // the values of the induction variable are initialVal + j * step, so the new bound is exact
+        const cond = loop.children[1].children[0] as BinaryOp;
+        const limit = counted.initialVal + iterations * counted.step;
+        const adjust = cond.kind == "le" ? -1 : cond.kind == "ge" ? 1 : 0;
+        cond.right.replaceWith(ClavaJoinPoints.integerLiteral(limit + adjust));
+
+        const stride = factor * counted.step;
+        loop.children[2].children[0].replaceWith(ClavaJoinPoints.exprLiteral(`${counted.inductionVar} ${stride > 0 ? "+=" : "-="} ${Math.abs(stride)}`));
+
+        let last: Statement = loop;
+        for (let j = iterations; j < counted.tripCount; j++) {
+            const value = counted.initialVal + j * counted.step;
+            const previous = last;
+            last = this.insertIteration(counted, template, (copy) => previous.insertAfter(copy), () => ClavaJoinPoints.integerLiteral(value));
+        }
+        if (iterations < counted.tripCount) {
+            this.analyzer.restoreFinalValues([counted], last);
+        }
+        this.log(`Unrolled loop on ${counted.inductionVar} by ${factor}, with ${counted.tripCount - iterations} remaining iteration(s)`);
+    }
+
+    /**
+     * Returns why the body cannot be copied once per iteration, or undefined if it can
+     */
+    private getRejectionReason(loop: Loop): string | undefined {
+        if (Query.searchFrom(loop.body, LabelStmt).get().length > 0 || Query.searchFrom(loop.body, GotoStmt).get().length > 0) {
+            return "body has labels or gotos";
+        }
+        for (const stmt of Query.searchFrom(loop.body, Statement)) {
+            const isBreak = AstPredicates.isBreak(stmt);
+            if (!isBreak && !AstPredicates.isContinue(stmt)) {
+                continue;
+            }
+            // breaks and continues of nested loops (and breaks of switches) are copied along with them
+            let parent = stmt.parent;
+            while (parent.astId !== loop.astId && !(parent instanceof Loop) && !(isBreak && parent instanceof Switch)) {
+                parent = parent.parent;
+            }
+            if (parent.astId === loop.astId) {
+                return "body has a break or continue";
+            }
+        }
+        return undefined;
+    }
+
+    /**
+     * Places a copy of the body in the AST, and then replaces the references to the induction variable in it
+     */
+    private insertIteration(counted: CountedLoop, body: Scope, place: (copy: Scope) => void, replacement: (ref: Varref) => Expression): Scope {
+        const copy = body.copy() as Scope;
+        place(copy);
+
+        for (const ref of Query.searchFrom(copy, Varref, { name: counted.inductionVar }).get()) {
+            ref.replaceWith(replacement(ref));
+        }
+        return copy;
+    }
+
+    private getDepth(loop: Loop): number {
+        let depth = 0;
+        let current = loop.getAncestor("loop");
+        while (current != undefined) {
+            depth++;
+            current = current.getAncestor("loop");
+        }
+        return depth;
+    }
+}
@@ -0,0 +1,322 @@
+import fs from "node:fs";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { CodeMaterializationCounter } from "../AstPredicates.js";
+import { ChangeJournal } from "../ChangeJournal.js";
+import { FoldingPropagationCombiner } from "../constfolding/FoldingPropagationCombiner.js";
+import { InitializerBlobs } from "../InitializerBlobs.js";
+import { ArrayFlattener } from "../flattening/ArrayFlattener.js";
+import { ScopeFlattener } from "../flattening/ScopeFlattener.js";
+import { StructFlattener } from "../flattening/StructFlattener.js";
+import { IndexStrengthReducer } from "../loop/IndexStrengthReducer.js";
+import { LoopCollapser } from "../loop/LoopCollapser.js";
+import { LoopInterchanger } from "../loop/LoopInterchanger.js";
+import { LoopTiler, LoopTilerOptions } from "../loop/LoopTiler.js";
+import { LoopUnroller, LoopUnrollerOptions } from "../loop/LoopUnroller.js";
+
+/**
+ * What a pass returns is interpreted as its number of changes: numbers are used as-is,
+ * booleans count as 0 or 1, arrays count as their length, and anything else is unknown.
+ */
+export type PassResult = number | boolean | unknown[] | void;
+
+export type PipelinePass = {
+    name: string,
+    run: () => PassResult,
+    // rebuilds the AST after the pass, like the Clava.rebuild() calls in between hand-written flows
+    rebuildAfter?: boolean
+}
+
+export type PassReport = {
+    name: string,
+    success: boolean,
+    error?: string,
+    wallTimeMs: number,
+    heapUsedBeforeMB: number,
+    heapUsedAfterMB: number,
+    // peak RSS of the whole process since it started, read after the pass; not the peak of the pass itself
+    processPeakRssMB: number,
+    rebuilds: number,
+    joinpointsBefore: number,
+    joinpointsAfter: number,
+    codeMaterializations: number,
+    // functions recorded in the ChangeJournal by the pass, or -1 if it may have changed all of them
+    changedFunctions: number,
+    changes: number | null
+}
+
+export type PipelineReport = {
+    startedAt: string,
+    totalTimeMs: number,
+    totalRebuilds: number,
+    passes: PassReport[]
+}
+
+export type PipelineOptions = {
+    // counting joinpoints walks the whole AST twice per pass, so it can be disabled for very large inputs
+    countJoinpoints?: boolean,
+    // counts the accesses to .code done by each pass, which wraps the .code getter while the pipeline runs
+    countCodeMaterializations?: boolean,
+    stopOnError?: boolean
+}
+
+/**
+ * Runs a list of passes in order, measuring each one of them. Passes run synchronously, so memory
+ * cannot be sampled while they run: heap usage is taken before and after each pass, and peak RSS is
+ * the process-wide maximum so far, as reported by the OS, so it only grows from pass to pass.
+ */
+export class TransformPipeline extends AdvancedTransform {
+    private passes: PipelinePass[] = [];
+    private options: Required<PipelineOptions>;
+    private lastReport: PipelineReport | undefined = undefined;
+
+    constructor(passes: PipelinePass[] = [], options: PipelineOptions = {}, silent: boolean = false) {
+        super("TransformPipeline", silent);
+        this.passes = [...passes];
+        this.options = { countJoinpoints: true, countCodeMaterializations: false, stopOnError: true, ...options };
+    }
+
+    public addPass(pass: PipelinePass): TransformPipeline {
+        this.passes.push(pass);
+        return this;
+    }
+
+    public run(): PipelineReport {
+        const report: PipelineReport = {
+            startedAt: new Date().toISOString(),
+            totalTimeMs: 0,
+            totalRebuilds: 0,
+            passes: []
+        };
+        const start = Date.now();
+        const rebuildsAtStart = AdvancedTransform.getRebuildCount();
+        const wasCounting = CodeMaterializationCounter.isEnabled();
+        if (this.options.countCodeMaterializations) {
+            CodeMaterializationCounter.enable();
+        }
+
+        for (const pass of this.passes) {
+            const passReport = this.runPass(pass);
+            report.passes.push(passReport);
+
+            if (!passReport.success && this.options.stopOnError) {
+                this.logError(`Pass ${pass.name} failed, skipping the remaining passes`);
+                break;
+            }
+        }
+        if (this.options.countCodeMaterializations && !wasCounting) {
+            CodeMaterializationCounter.disable();
+        }
+        report.totalTimeMs = Date.now() - start;
+        report.totalRebuilds = AdvancedTransform.getRebuildCount() - rebuildsAtStart;
+        this.lastReport = report;
+
+        this.logLine();
+        for (const pass of report.passes) {
+            this.log(`${pass.name}: ${pass.wallTimeMs} ms, ${pass.changes ?? "?"} changes, ${pass.rebuilds} rebuilds, ${pass.joinpointsBefore} -> ${pass.joinpointsAfter} joinpoints, ${pass.codeMaterializations} .code accesses`);
+        }
+        this.log(`Pipeline finished in ${report.totalTimeMs} ms with ${report.totalRebuilds} rebuilds`);
+        this.logLine();
+        return report;
+    }
+
+    public getLastReport(): PipelineReport | undefined {
+        return this.lastReport;
+    }
+
+    public writeReport(path: string, report: PipelineReport | undefined = this.lastReport): void {
+        if (report == undefined) {
+            this.logWarning("No report to write, the pipeline has not been run yet");
+            return;
+        }
+        fs.writeFileSync(path, JSON.stringify(report, null, 4));
+        this.log(`Wrote pipeline report to ${path}`);
+    }
+
+    private runPass(pass: PipelinePass): PassReport {
+        this.log(`Running pass ${pass.name}`);
+        const rebuildsBefore = AdvancedTransform.getRebuildCount();
+        const joinpointsBefore = this.countJoinpoints();
+        const codeBefore = CodeMaterializationCounter.getCount();
+        const mark = ChangeJournal.mark();
+        const heapBefore = process.memoryUsage().heapUsed;
+        const start = Date.now();
+
+        let result: PassResult = undefined;
+        let error: string | undefined = undefined;
+        try {
+            result = pass.run();
+            if (pass.rebuildAfter && !this.rebuildAfterTransform()) {
+                error = "Rebuild after pass failed";
+            }
+        } catch (e) {
+            error = `${e}`;
+            this.logError(`Pass ${pass.name} threw: ${error}`);
+        }
+        const wallTimeMs = Date.now() - start;
+        const codeMaterializations = CodeMaterializationCounter.isEnabled() ? CodeMaterializationCounter.getCount() - codeBefore : -1;
+
+        return {
+            name: pass.name,
+            success: error == undefined,
+            error: error,
+            wallTimeMs: wallTimeMs,
+            heapUsedBeforeMB: this.toMB(heapBefore),
+            heapUsedAfterMB: this.toMB(process.memoryUsage().heapUsed),
+            processPeakRssMB: this.toMB(process.resourceUsage().maxRSS * 1024),
+            rebuilds: AdvancedTransform.getRebuildCount() - rebuildsBefore,
+            joinpointsBefore: joinpointsBefore,
+            joinpointsAfter: this.countJoinpoints(),
+            codeMaterializations: codeMaterializations,
+            changedFunctions: ChangeJournal.getDirtySince(mark)?.length ?? -1,
+            changes: this.toChanges(result)
+        };
+    }
+
+    private countJoinpoints(): number {
+        if (!this.options.countJoinpoints) {
+            return -1;
+        }
+        return Clava.getProgram().descendants.length;
+    }
+
+    private toChanges(result: PassResult): number | null {
+        if (typeof result === "number") {
+            return result;
+        }
+        if (typeof result === "boolean") {
+            return result ? 1 : 0;
+        }
+        if (Array.isArray(result)) {
+            return result.length;
+        }
+        return null;
+    }
+
+    private toMB(bytes: number): number {
+        return Math.round(bytes / 1024 / 1024 * 10) / 10;
+    }
+}
+
+/**
+ * Ready-made passes for the transforms most commonly chained together
+ */
+export const PipelinePasses = {
+    arrayFlattening(rebuildAfter: boolean = true): PipelinePass {
+        return {
+            name: "ArrayFlattening",
+            run: () => new ArrayFlattener(true).flattenAll(),
+            rebuildAfter: rebuildAfter
+        };
+    },
+
+    /**
+     * Compacts large initializer lists into blobs, which every later rebuild keeps compacted.
+     * Meant to be the first pass of pipelines over programs with big tables.
+     */
+    initializerCompaction(threshold: number = InitializerBlobs.DEFAULT_THRESHOLD): PipelinePass {
+        return {
+            name: "InitializerCompaction",
+            run: () => InitializerBlobs.compactAll(threshold)
+        };
+    },
+
+    constantFolding(useWorklist: boolean = true, rebuildAfter: boolean = true): PipelinePass {
+        return {
+            name: "ConstantFoldingPropagation",
+            run: () => {
+                const folder = new FoldingPropagationCombiner(true);
+                let changes = 0;
+                for (const fun of Query.search(FunctionJp, { isImplementation: true })) {
+                    changes += useWorklist ? folder.doWorklistUntilStop(fun) : folder.doPassesUntilStop(fun);
+                }
+                return changes;
+            },
+            rebuildAfter: rebuildAfter
+        };
+    },
+
+    structFlattening(structNames?: string[]): PipelinePass {
+        return {
+            name: "StructFlattening",
+            run: () => {
+                const flattener = new StructFlattener(undefined, true);
+                if (structNames == undefined) {
+                    return flattener.flattenAll();
+                }
+                return structNames.filter((name) => flattener.flattenByName(name));
+            }
+        };
+    },
+
+    /**
+     * A pass that applies a transform to every function implementation, adding up the changes,
+     * and then rebuilds the AST. The transform is created once, when the pass runs.
+     */
+    perFunction<T>(name: string, create: () => T, apply: (transform: T, fun: FunctionJp) => number): PipelinePass {
+        return {
+            name: name,
+            run: () => {
+                const transform = create();
+                let changes = 0;
+                for (const fun of Query.search(FunctionJp, { isImplementation: true })) {
+                    changes += apply(transform, fun);
+                }
+                return changes;
+            },
+            rebuildAfter: true
+        };
+    },
+
+    loopUnrolling(options: LoopUnrollerOptions = {}): PipelinePass {
+        return PipelinePasses.perFunction("LoopUnrolling",
+            () => new LoopUnroller(options, true),
+            (unroller, fun) => unroller.unrollAllInFunction(fun));
+    },
+
+    loopCollapsing(): PipelinePass {
+        return PipelinePasses.perFunction("LoopCollapsing",
+            () => new LoopCollapser(true),
+            (collapser, fun) => collapser.collapseAllInFunction(fun));
+    },
+
+    loopInterchange(): PipelinePass {
+        return PipelinePasses.perFunction("LoopInterchange",
+            () => new LoopInterchanger(true),
+            (interchanger, fun) => interchanger.interchangeAllInFunction(fun));
+    },
+
+    indexStrengthReduction(): PipelinePass {
+        return PipelinePasses.perFunction("IndexStrengthReduction",
+            () => new IndexStrengthReducer(true),
+            (reducer, fun) => reducer.reduceAllInFunction(fun));
+    },
+
+    /**
+     * @param annotatedOnly only tiles the nests with a "#pragma clava tile" (with its sizes), rather than every nest
+     */
+    loopTiling(options: LoopTilerOptions = {}, annotatedOnly: boolean = true): PipelinePass {
+        return PipelinePasses.perFunction("LoopTiling",
+            () => new LoopTiler(options, true),
+            (tiler, fun) => annotatedOnly ? tiler.tileAnnotatedInFunction(fun) : tiler.tileAllInFunction(fun));
+    },
+
+    scopeFlattening(): PipelinePass {
+        return PipelinePasses.perFunction("ScopeFlattening",
+            () => new ScopeFlattener(true),
+            (flattener, fun) => flattener.flattenAllInFunction(fun));
+    },
+
+    /**
+     * Only rebuilds the AST, through the same path as rebuildAfter, so it is counted in the report
+     */
+    rebuild(): PipelinePass {
+        return {
+            name: "Rebuild",
+            run: () => { },
+            rebuildAfter: true
+        };
+    }
+};
@@ -1,10 +1,12 @@
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
-import { Call, FileJp, FunctionJp, Include, Statement, Struct, TypedefNameDecl, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import { FileJp, FunctionJp, Include, Statement, StorageClass, Struct, TypedefNameDecl, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { AdvancedTransform } from "../AdvancedTransform.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { CallGraph } from "./CallGraph.js";
 
 export class Amalgamator extends AdvancedTransform {
+    private signatureCache: Map<string, string> = new Map();
 
     constructor(silent: boolean = false) {
         super("Amalgamator", silent);
@@ -14,6 +16,8 @@ export class Amalgamator extends AdvancedTransform {
         const ext = Clava.isCxx() ? "cpp" : "c";
         const fullFileName = `${fileName}.${ext}`;
         const newFile = ClavaJoinPoints.file(fullFileName);
+        const start = Date.now();
+        this.signatureCache.clear();
         this.log(`Creating amalgamated file: ${fullFileName}`);
 
         const userIncludes = this.addIncludes(newFile);
@@ -36,9 +40,10 @@ export class Amalgamator extends AdvancedTransform {
         this.log(`Added ${nImpls} function implementations to the amalgamated file.`);
 
         Clava.getProgram().addFile(newFile);
+        CallGraph.invalidate();
         const userIncludesFiles = this.getUserIncludeFiles(userIncludes);
 
-        this.log(`Amalgamation completed in file '${newFile.name}' with ${userIncludesFiles.length} additional user includes`);
+        this.log(`Amalgamation completed in file '${newFile.name}' with ${userIncludesFiles.length} additional user includes in ${Date.now() - start} ms`);
         return [newFile, userIncludesFiles];
     }
 
@@ -58,6 +63,7 @@ export class Amalgamator extends AdvancedTransform {
             file.detach();
         });
         const success = Clava.rebuild();
+        CallGraph.invalidate();
         if (success) {
             this.log(`Replaced AST with amalgamation from file ${sourceFile.name}`);
         } else {
@@ -126,6 +132,16 @@ export class Amalgamator extends AdvancedTransform {
     }
 
     private getSignature(func: FunctionJp): string {
+        const cached = this.signatureCache.get(func.astId);
+        if (cached != undefined) {
+            return cached;
+        }
+        const signature = this.computeSignature(func);
+        this.signatureCache.set(func.astId, signature);
+        return signature;
+    }
+
+    private computeSignature(func: FunctionJp): string {
         try {
             const operatorRegex = /\boperator\s*[\+\-\*\/%<>=!&|^~\[\]()]+/;
             if (func.name.match(operatorRegex)) {
@@ -143,16 +159,20 @@ export class Amalgamator extends AdvancedTransform {
 
     private getAllCalledFunctions(entryPoint: FunctionJp): Set<string> {
         const signatures = new Set<string>();
+        const callGraph = CallGraph.get();
+        const reachable = callGraph.getReachable(entryPoint);
+
+        for (const component of callGraph.getRecursiveComponents(entryPoint)) {
+            this.log(`Found recursive call cycle: ${component.join(", ")}`);
+        }
 
-        for (const call of Query.searchFrom(entryPoint, Call)) {
-            const fun = call.function;
+        // the entry point is always the first reachable function, and its signature is added by the caller
+        for (const fun of reachable.slice(1)) {
             const signature = this.getSignature(fun);
 
-            if (fun.isImplementation && signature !== "") {
+            if (signature !== "") {
                 signatures.add(signature);
             }
-            const childSignatures = this.getAllCalledFunctions(fun);
-            childSignatures.forEach(sig => signatures.add(sig));
         }
         return signatures;
     }
@@ -162,7 +182,7 @@ export class Amalgamator extends AdvancedTransform {
         const signatures = this.getAllCalledFunctions(entryPoint);
         const thisSignature = this.getSignature(entryPoint);
         if (thisSignature !== "") {
-            signatures.add(this.getSignature(entryPoint));
+            signatures.add(thisSignature);
         }
 
         signatures.forEach(signature => {
@@ -180,9 +200,11 @@ export class Amalgamator extends AdvancedTransform {
             if (global.filename.endsWith(".h") || global.filename.endsWith(".hpp")) {
                 continue; // Skip globals defined in header files
             }
-            global.code.startsWith("extern") ?
-                externalGlobals.push(global.code.split(" ").slice(1).join(" ")) :
-                realGlobals.push(global.code);
+            // the declaration is printed once, and the storage class is checked structurally
+            const code = global.code;
+            global.storageClass === StorageClass.EXTERN ?
+                externalGlobals.push(code.split(" ").slice(1).join(" ")) :
+                realGlobals.push(code);
         }
         externalGlobals.forEach(global => {
             if (!realGlobals.includes(global)) {
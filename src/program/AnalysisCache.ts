@@ -0,0 +1,246 @@
+import crypto from "node:crypto";
+import fs from "node:fs";
+import path from "node:path";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { FileJp, FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { LoopCharacterization, LoopCharacterizer } from "../loop/LoopCharacterizer.js";
+
+/**
+ * Bump whenever the format or the semantics of a cached analysis change
+ */
+export const ANALYSIS_CACHE_VERSION = "2";
+
+export type AnalysisCacheStats = {
+    hits: number,
+    misses: number,
+    hitsByKind: Record<string, number>,
+    missesByKind: Record<string, number>
+}
+
+/**
+ * On-disk cache of analysis results, stored as JSON files under a cache directory.
+ * Each entry is keyed by the hash of the translation unit(s) it was computed from (including the headers
+ * they include and the Clava arguments, e.g., the standard and the flags), by the cache version,
+ * and by a stage name. Source files are hashed from disk, so the stage is what tells apart analyses of the
+ * input as parsed from analyses done after some transformations: only use the same stage for the same,
+ * deterministic, sequence of transformations (and options) applied to the same input.
+ */
+export class AnalysisCache extends AdvancedTransform {
+    private cacheDir: string;
+    private stage: string;
+    private version: string;
+    private clavaArgs: string[] | undefined = undefined;
+    private fileHashes: Map<string, string> = new Map();
+    private contentHashes: Map<string, string> = new Map();
+    private headers: FileJp[] | undefined = undefined;
+    private stats: AnalysisCacheStats = { hits: 0, misses: 0, hitsByKind: {}, missesByKind: {} };
+
+    constructor(cacheDir: string = ".clava-analysis-cache", stage: string = "input", version: string = ANALYSIS_CACHE_VERSION, silent: boolean = false) {
+        super("AnalysisCache", silent);
+        this.cacheDir = cacheDir;
+        this.stage = stage;
+        this.version = version;
+    }
+
+    public setStage(stage: string): void {
+        this.stage = stage;
+    }
+
+    /**
+     * Sets the Clava arguments that are part of every key. By default, they are the standard and the
+     * flags of the current Clava run.
+     */
+    public setClavaArgs(args: string[]): void {
+        this.clavaArgs = args;
+        this.fileHashes.clear();
+    }
+
+    /**
+     * Returns the cached value of an analysis for the given unit hash, computing and storing it on a miss.
+     * The computed value must survive a JSON round trip.
+     */
+    public getOrCompute<T>(kind: string, unitHash: string, compute: () => T): T {
+        const entryPath = this.getEntryPath(kind, unitHash);
+
+        if (fs.existsSync(entryPath)) {
+            try {
+                const value = JSON.parse(fs.readFileSync(entryPath, "utf8")) as T;
+                this.count(kind, true);
+                return value;
+            } catch (e) {
+                this.logWarning(`Discarding unreadable cache entry ${entryPath}: ${e}`);
+            }
+        }
+        this.count(kind, false);
+        const value = compute();
+
+        fs.mkdirSync(path.dirname(entryPath), { recursive: true });
+        fs.writeFileSync(entryPath, JSON.stringify(value));
+        return value;
+    }
+
+    /**
+     * Hashes a translation unit from its file on disk or, for files that only exist in the AST, from its code,
+     * together with every user header it (transitively) includes and the Clava arguments. System headers
+     * (i.e., angled includes) only contribute their names.
+     */
+    public hashFile(file: FileJp): string {
+        const key = this.getFileKey(file);
+        if (this.fileHashes.has(key)) {
+            return this.fileHashes.get(key)!;
+        }
+        const parts = [this.hash(...this.getClavaArgs()), this.hashContent(file)];
+        const visited = new Set<string>([key]);
+        const pending = [file];
+
+        while (pending.length > 0) {
+            const current = pending.pop()!;
+            for (const include of current.includes) {
+                if (include.isAngled) {
+                    parts.push(`<${include.name}>`);
+                    continue;
+                }
+                const header = this.findHeader(current, include.name);
+                const headerKey = header instanceof FileJp ? this.getFileKey(header) : header ?? `"${include.name}"`;
+                if (visited.has(headerKey)) {
+                    continue;
+                }
+                visited.add(headerKey);
+
+                if (header instanceof FileJp) {
+                    parts.push(this.hashContent(header));
+                    pending.push(header);
+                }
+                else if (header != undefined) {
+                    // a header that is not part of the program; its own includes are not followed
+                    parts.push(this.hash(fs.readFileSync(header)));
+                }
+                else {
+                    parts.push(headerKey);
+                }
+            }
+        }
+        const hash = this.hash(...parts);
+
+        this.fileHashes.set(key, hash);
+        return hash;
+    }
+
+    public hashProgram(): string {
+        const hashes = Query.search(FileJp).get()
+            .map((file) => this.hashFile(file))
+            .sort();
+        return this.hash(...hashes);
+    }
+
+    /**
+     * Characterizations of every loop in a function, in AST order.
+     */
+    public getLoopCharacterizations(fun: FunctionJp): LoopCharacterization[] {
+        const file = fun.getAncestor("file") as FileJp;
+        const unitHash = this.hash(this.hashFile(file), fun.name);
+
+        return this.getOrCompute("loops", unitHash, () => {
+            const characterizer = new LoopCharacterizer(true);
+            return Query.searchFrom(fun, Loop).get().map((loop) => characterizer.characterize(loop));
+        });
+    }
+
+    public getStats(): AnalysisCacheStats {
+        return this.stats;
+    }
+
+    public report(): AnalysisCacheStats {
+        this.logLine();
+        const kinds = new Set([...Object.keys(this.stats.hitsByKind), ...Object.keys(this.stats.missesByKind)]);
+        for (const kind of kinds) {
+            this.log(`${kind}: ${this.stats.hitsByKind[kind] ?? 0} hits, ${this.stats.missesByKind[kind] ?? 0} misses`);
+        }
+        this.log(`Total: ${this.stats.hits} hits, ${this.stats.misses} misses (stage "${this.stage}", cache in ${this.cacheDir})`);
+        this.logLine();
+        return this.stats;
+    }
+
+    public clear(): void {
+        fs.rmSync(this.cacheDir, { recursive: true, force: true });
+        this.fileHashes.clear();
+        this.contentHashes.clear();
+        this.headers = undefined;
+    }
+
+    private getFileKey(file: FileJp): string {
+        return file.filepath ?? file.name;
+    }
+
+    private hashContent(file: FileJp): string {
+        const key = this.getFileKey(file);
+        if (this.contentHashes.has(key)) {
+            return this.contentHashes.get(key)!;
+        }
+        const content = file.filepath != undefined && fs.existsSync(file.filepath) ?
+            fs.readFileSync(file.filepath) :
+            file.code;
+        const hash = this.hash(`${file.name}\n`, content);
+
+        this.contentHashes.set(key, hash);
+        return hash;
+    }
+
+    /**
+     * Finds an included header among the files of the program, preferring the one next to the includer,
+     * or else on disk, relative to the includer
+     * @returns the header, its path on disk, or undefined if it was not found
+     */
+    private findHeader(includer: FileJp, name: string): FileJp | string | undefined {
+        if (this.headers == undefined) {
+            this.headers = Query.search(FileJp).get();
+        }
+        const dir = includer.filepath != undefined ? path.dirname(includer.filepath) : undefined;
+        const local = dir != undefined ? path.resolve(dir, name) : undefined;
+        const suffix = path.sep + path.normalize(name);
+
+        const candidates = this.headers.filter((file) => file.filepath != undefined ?
+            path.resolve(file.filepath) == local || path.resolve(file.filepath).endsWith(suffix) :
+            file.name == path.basename(name));
+        const header = candidates.find((file) => file.filepath != undefined && path.resolve(file.filepath) == local) ?? candidates[0];
+        if (header != undefined) {
+            return header;
+        }
+        return local != undefined && fs.existsSync(local) ? local : undefined;
+    }
+
+    private getClavaArgs(): string[] {
+        if (this.clavaArgs == undefined) {
+            const program = Clava.getProgram();
+            this.clavaArgs = [program.standard, ...program.userFlags];
+        }
+        return this.clavaArgs;
+    }
+
+    private getEntryPath(kind: string, unitHash: string): string {
+        const key = this.hash(this.version, this.stage, kind, unitHash);
+        return path.join(this.cacheDir, kind, `${key}.json`);
+    }
+
+    private count(kind: string, isHit: boolean): void {
+        if (isHit) {
+            this.stats.hits++;
+            this.stats.hitsByKind[kind] = (this.stats.hitsByKind[kind] ?? 0) + 1;
+        }
+        else {
+            this.stats.misses++;
+            this.stats.missesByKind[kind] = (this.stats.missesByKind[kind] ?? 0) + 1;
+        }
+    }
+
+    private hash(...parts: (string | Buffer)[]): string {
+        const hasher = crypto.createHash("sha256");
+        for (const part of parts) {
+            hasher.update(part);
+            hasher.update("\0");
+        }
+        return hasher.digest("hex");
+    }
+}
@@ -0,0 +1,337 @@
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import { Call, FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+
+/**
+ * Program-wide index of function implementations and the calls between them.
+ * It is built with a single walk over the AST and shared by every transform until
+ * either the AST is rebuilt or a transform that adds or removes calls invalidates it.
+ * Functions are indexed by astId, so same-named static functions of different translation units
+ * are kept apart; queries by name cover every implementation with that name, and queries by
+ * joinpoint only that implementation.
+ */
+export class CallGraph {
+    private static cached: CallGraph | undefined = undefined;
+    private static cachedProgramId: string = "";
+
+    private functions: Map<string, FunctionJp> = new Map();
+    private idsByName: Map<string, string[]> = new Map();
+    private callees: Map<string, string[]> = new Map();
+    private callers: Map<string, Set<string>> = new Map();
+    private callSites: Map<string, Call[]> = new Map();
+    private callsTo: Map<string, Call[]> = new Map();
+    private callsById: Map<string, [Call, string]> = new Map();
+
+    private constructor() {
+        this.build();
+    }
+
+    /**
+     * Returns the call graph of the current program, building it only if the cached one
+     * was invalidated or belongs to an AST that has since been rebuilt.
+     */
+    public static get(): CallGraph {
+        const programId = Clava.getProgram().astId;
+
+        if (CallGraph.cached == undefined || CallGraph.cachedProgramId !== programId) {
+            CallGraph.cached = new CallGraph();
+            CallGraph.cachedProgramId = programId;
+        }
+        return CallGraph.cached;
+    }
+
+    /**
+     * Drops the cached call graph. Must be called by any transform that adds or removes calls,
+     * or that adds or removes function implementations.
+     */
+    public static invalidate(): void {
+        CallGraph.cached = undefined;
+        CallGraph.cachedProgramId = "";
+    }
+
+    public static isValid(): boolean {
+        return CallGraph.cached != undefined;
+    }
+
+    public getFunctions(): FunctionJp[] {
+        return Array.from(this.functions.values());
+    }
+
+    /**
+     * Returns the first implementation with the given name (there may be more, if they are static)
+     */
+    public getFunction(name: string): FunctionJp | undefined {
+        const ids = this.idsByName.get(name);
+        return ids != undefined ? this.functions.get(ids[0]) : undefined;
+    }
+
+    public getCallees(fun: FunctionJp | string): FunctionJp[] {
+        const ids = new Set(this.resolve(fun).flatMap((id) => this.callees.get(id) ?? []));
+        return Array.from(ids).map((id) => this.functions.get(id)!);
+    }
+
+    public getCallers(fun: FunctionJp | string): FunctionJp[] {
+        const ids = new Set(this.resolve(fun).flatMap((id) => Array.from(this.callers.get(id) ?? [])));
+        return Array.from(ids).map((id) => this.functions.get(id)!);
+    }
+
+    /**
+     * Returns every call inside the body of a function, in AST order,
+     * including calls to functions without an implementation.
+     */
+    public getCallSites(fun: FunctionJp | string): Call[] {
+        return this.resolve(fun).flatMap((id) => this.callSites.get(id) ?? []);
+    }
+
+    /**
+     * Returns every call, located in some function implementation, to a function with the given name.
+     */
+    public getCallsTo(fun: FunctionJp | string): Call[] {
+        const name = typeof fun === "string" ? fun : fun.name;
+        return this.callsTo.get(name) ?? [];
+    }
+
+    public getCallById(astId: string): Call | undefined {
+        return this.callsById.get(astId)?.[0];
+    }
+
+    /**
+     * Returns the function implementation that contains a given call, if known.
+     */
+    public getCallerOf(call: Call): FunctionJp | undefined {
+        const entry = this.callsById.get(call.astId);
+        return entry != undefined ? this.functions.get(entry[1]) : undefined;
+    }
+
+    /**
+     * Returns all the function implementations reachable from a starting point, starting point included.
+     * The order is the same depth-first order historically used by getFunctionChain,
+     * i.e., the starting point is always the first element.
+     */
+    public getReachable(startingPoint: FunctionJp | string): FunctionJp[] {
+        return this.getReachableIds(startingPoint).map((id) => this.functions.get(id)!);
+    }
+
+    public getReachableNames(startingPoint: FunctionJp | string): string[] {
+        return this.getReachable(startingPoint).map((fun) => fun.name);
+    }
+
+    /**
+     * Returns the strongly connected components of the functions reachable from the
+     * given starting point (or of the whole program, if none is given), using an iterative
+     * version of Tarjan's algorithm. Components are returned in reverse topological order,
+     * i.e., callees come before their callers, and hold the names of their functions.
+     */
+    public getStronglyConnectedComponents(startingPoint?: FunctionJp | string): string[][] {
+        return this.getComponentIds(startingPoint).map((component) => component.map((id) => this.functions.get(id)!.name));
+    }
+
+    /**
+     * Returns the components that contain recursion, i.e., those with more than one
+     * function or with a single function that calls itself.
+     */
+    public getRecursiveComponents(startingPoint?: FunctionJp | string): string[][] {
+        return this.getComponentIds(startingPoint)
+            .filter((component) => component.length > 1 || (this.callees.get(component[0]) ?? []).includes(component[0]))
+            .map((component) => component.map((id) => this.functions.get(id)!.name));
+    }
+
+    /**
+     * Checks whether a call is located in a function reachable from the given starting point.
+     */
+    public isCallReachableFrom(call: Call, startingPoint: FunctionJp | string): boolean {
+        const entry = this.callsById.get(call.astId);
+        if (entry == undefined) {
+            return false;
+        }
+        return this.getReachableIds(startingPoint).includes(entry[1]);
+    }
+
+    /**
+     * Removes a call from the index without rebuilding it. Used by transforms that
+     * delete or replace calls whose removal is already known to them.
+     */
+    public removeCall(call: Call): void {
+        const entry = this.callsById.get(call.astId);
+        if (entry == undefined) {
+            return;
+        }
+        const [, callerId] = entry;
+        this.callsById.delete(call.astId);
+
+        const sites = this.callSites.get(callerId) ?? [];
+        this.callSites.set(callerId, sites.filter((site) => site.astId !== call.astId));
+
+        const sitesTo = this.callsTo.get(call.name) ?? [];
+        this.callsTo.set(call.name, sitesTo.filter((site) => site.astId !== call.astId));
+
+        const calleeId = this.resolveCallee(call, this.functions.get(callerId)!);
+        if (calleeId == undefined) {
+            return;
+        }
+        const calleeList = this.callees.get(callerId) ?? [];
+        const idx = calleeList.indexOf(calleeId);
+        if (idx == -1) {
+            return;
+        }
+        calleeList.splice(idx, 1);
+        if (!calleeList.includes(calleeId)) {
+            this.callers.get(calleeId)?.delete(callerId);
+        }
+    }
+
+    /**
+     * A joinpoint stands for itself (or, if it is not an indexed implementation, e.g., a prototype,
+     * for the implementations with its name), and a name for every implementation with that name
+     */
+    private resolve(fun: FunctionJp | string): string[] {
+        if (typeof fun !== "string" && this.functions.has(fun.astId)) {
+            return [fun.astId];
+        }
+        return this.idsByName.get(typeof fun === "string" ? fun : fun.name) ?? [];
+    }
+
+    /**
+     * The implementation a call refers to: the one Clava links it to, or else the implementation with
+     * its name in the caller's file (e.g., a static function), or in any other file
+     */
+    private resolveCallee(call: Call, caller: FunctionJp): string | undefined {
+        const callee = call.function;
+        if (callee == undefined) {
+            return undefined;
+        }
+        if (this.functions.has(callee.astId)) {
+            return callee.astId;
+        }
+        const ids = this.idsByName.get(callee.name) ?? [];
+        const sameFile = ids.find((id) => this.functions.get(id)!.filename === caller.filename);
+        return sameFile ?? ids[0];
+    }
+
+    private getReachableIds(startingPoint: FunctionJp | string): string[] {
+        const reachable: string[] = [];
+        const stack = this.resolve(startingPoint).slice().reverse();
+        const visited = new Set<string>();
+
+        while (stack.length > 0) {
+            const current = stack.pop()!;
+            if (visited.has(current)) {
+                continue;
+            }
+            visited.add(current);
+            reachable.push(current);
+
+            stack.push(...(this.callees.get(current) ?? []));
+        }
+        return reachable;
+    }
+
+    private getComponentIds(startingPoint?: FunctionJp | string): string[][] {
+        const roots = startingPoint == undefined ?
+            Array.from(this.functions.keys()) :
+            this.resolve(startingPoint);
+
+        const index = new Map<string, number>();
+        const lowLink = new Map<string, number>();
+        const onStack = new Set<string>();
+        const stack: string[] = [];
+        const components: string[][] = [];
+        let nextIndex = 0;
+
+        for (const root of roots) {
+            if (index.has(root)) {
+                continue;
+            }
+            // each frame holds a function and the position of the next callee to visit
+            const frames: [string, number][] = [[root, 0]];
+            index.set(root, nextIndex);
+            lowLink.set(root, nextIndex);
+            nextIndex++;
+            stack.push(root);
+            onStack.add(root);
+
+            while (frames.length > 0) {
+                const frame = frames[frames.length - 1];
+                const [current, calleeIdx] = frame;
+                const calleeList = this.callees.get(current) ?? [];
+
+                if (calleeIdx < calleeList.length) {
+                    const callee = calleeList[calleeIdx];
+                    frame[1]++;
+
+                    if (!index.has(callee)) {
+                        index.set(callee, nextIndex);
+                        lowLink.set(callee, nextIndex);
+                        nextIndex++;
+                        stack.push(callee);
+                        onStack.add(callee);
+                        frames.push([callee, 0]);
+                    }
+                    else if (onStack.has(callee)) {
+                        lowLink.set(current, Math.min(lowLink.get(current)!, index.get(callee)!));
+                    }
+                    continue;
+                }
+
+                frames.pop();
+                if (frames.length > 0) {
+                    const parent = frames[frames.length - 1][0];
+                    lowLink.set(parent, Math.min(lowLink.get(parent)!, lowLink.get(current)!));
+                }
+
+                if (lowLink.get(current) === index.get(current)) {
+                    const component: string[] = [];
+                    let member: string;
+                    do {
+                        member = stack.pop()!;
+                        onStack.delete(member);
+                        component.push(member);
+                    } while (member !== current);
+                    components.push(component);
+                }
+            }
+        }
+        return components;
+    }
+
+    private build(): void {
+        for (const fun of Query.search(FunctionJp, { isImplementation: true })) {
+            if (this.functions.has(fun.astId)) {
+                continue;
+            }
+            this.functions.set(fun.astId, fun);
+            if (!this.idsByName.has(fun.name)) {
+                this.idsByName.set(fun.name, []);
+            }
+            this.idsByName.get(fun.name)!.push(fun.astId);
+            this.callees.set(fun.astId, []);
+            this.callSites.set(fun.astId, []);
+        }
+
+        for (const [id, fun] of this.functions) {
+            const sites = this.callSites.get(id)!;
+            const calleeList = this.callees.get(id)!;
+
+            for (const call of Query.searchFrom(fun, Call)) {
+                sites.push(call);
+                this.callsById.set(call.astId, [call, id]);
+
+                if (!this.callsTo.has(call.name)) {
+                    this.callsTo.set(call.name, []);
+                }
+                this.callsTo.get(call.name)!.push(call);
+
+                const calleeId = this.resolveCallee(call, fun);
+                if (calleeId == undefined) {
+                    continue;
+                }
+                calleeList.push(calleeId);
+
+                if (!this.callers.has(calleeId)) {
+                    this.callers.set(calleeId, new Set());
+                }
+                this.callers.get(calleeId)!.add(id);
+            }
+        }
+    }
+}
@@ -0,0 +1,254 @@
+import fs from "node:fs";
+import path from "node:path";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { BuiltinType, InitList, QualType, StorageClass, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AdvancedTransform } from "../AdvancedTransform.js";
+import { AstPredicates } from "../AstPredicates.js";
+import { InitializerBlobs } from "../InitializerBlobs.js";
+
+export enum TableEmissionMode {
+    // an assembly file defines the symbol with .incbin, and the C/C++ code keeps an extern declaration
+    INCBIN = "incbin",
+    // the definition stays in the C/C++ code, with a C23 #embed initializer; only for byte-sized elements
+    EMBED = "embed"
+}
+
+export type ConstantTableExporterOptions = {
+    // tables smaller than this stay in the code
+    minBytes?: number,
+    mode?: TableEmissionMode,
+    asmFileName?: string
+}
+
+export type ExportedTable = {
+    name: string,
+    elementType: string,
+    elements: number,
+    bytes: number,
+    binFile: string,
+    mode: TableEmissionMode
+}
+
+// sizes for LP64 targets, which is what the woven code is compiled for
+const ELEMENT_SIZES: Record<string, number> = {
+    "char": 1, "signed char": 1, "unsigned char": 1, "_Bool": 1, "bool": 1,
+    "short": 2, "unsigned short": 2,
+    "int": 4, "unsigned int": 4, "float": 4,
+    "long": 8, "unsigned long": 8, "long long": 8, "unsigned long long": 8, "double": 8
+};
+
+/**
+ * Moves large global constant arrays out of the generated code and into binary files, so that woven
+ * benchmarks do not carry (and compile) tens of thousands of lines of literal data. The symbol keeps
+ * its name and type: either an assembly file defines it with .incbin, and the array becomes an
+ * extern declaration, or the initializer becomes an #embed of the binary file.
+ *
+ * Tables with internal linkage (static ones and, in C++, const ones not declared extern) can only be
+ * embedded, as an extern declaration would give them external linkage and clash with same-named tables
+ * of other translation units.
+ *
+ * The binary files are little-endian, and the assembly is for ELF targets. Since .incbin paths are
+ * resolved by the assembler, the generated .S must be assembled with the output directory in its
+ * include path (e.g., gcc -Wa,-I<dir>).
+ */
+export class ConstantTableExporter extends AdvancedTransform {
+    private options: Required<ConstantTableExporterOptions>;
+    private binFiles: Set<string> = new Set();
+
+    constructor(options: ConstantTableExporterOptions = {}, silent: boolean = false) {
+        super("ConstantTableExporter", silent);
+        this.options = {
+            minBytes: 4096,
+            mode: TableEmissionMode.INCBIN,
+            asmFileName: "constant_tables.S",
+            ...options
+        };
+    }
+
+    public exportAll(outputDir: string): ExportedTable[] {
+        const exported: ExportedTable[] = [];
+        fs.mkdirSync(outputDir, { recursive: true });
+        this.binFiles.clear();
+
+        for (const decl of Query.search(Vardecl, { isGlobal: true }).get()) {
+            const table = this.exportTable(decl, outputDir);
+            if (table != undefined) {
+                exported.push(table);
+            }
+        }
+
+        const assembled = exported.filter((table) => table.mode == TableEmissionMode.INCBIN);
+        if (assembled.length > 0) {
+            const asmPath = path.join(outputDir, this.options.asmFileName);
+            fs.writeFileSync(asmPath, this.generateAssembly(assembled));
+            this.log(`Wrote ${asmPath}, which must be assembled and linked with the woven code`);
+        }
+        if (exported.length > 0) {
+            this.markAllDirty();
+        }
+
+        const bytes = exported.reduce((acc, table) => acc + table.bytes, 0);
+        this.log(`Exported ${exported.length} constant table(s) with ${bytes} bytes to ${outputDir}`);
+        return exported;
+    }
+
+    /**
+     * Exports a single table, if it is a large enough global constant array of a scalar type
+     * whose initializer is made only of numeric literals.
+     */
+    public exportTable(decl: Vardecl, outputDir: string): ExportedTable | undefined {
+        if (!decl.type.isArray || !decl.hasInit || !InitializerBlobs.isConstArray(decl.type)) {
+            return undefined;
+        }
+        const elementType = this.getElementType(decl);
+        const elementSize = ELEMENT_SIZES[elementType];
+        if (elementSize == undefined) {
+            return undefined;
+        }
+        let mode = this.options.mode;
+        if (mode == TableEmissionMode.EMBED && elementSize != 1) {
+            this.logWarning(`#embed only initializes byte arrays, using .incbin for table ${decl.name}`);
+            mode = TableEmissionMode.INCBIN;
+        }
+        if (mode == TableEmissionMode.INCBIN && this.hasInternalLinkage(decl)) {
+            this.logWarning(`Keeping table ${decl.name} in the code, it has internal linkage and an extern declaration would change it`);
+            return undefined;
+        }
+
+        const dims = decl.type.arrayDims;
+        const elements = dims.reduce((acc, dim) => acc * dim, 1);
+        if (dims.some((dim) => !(dim > 0)) || elements * elementSize < this.options.minBytes) {
+            return undefined;
+        }
+
+        const values = this.getValues(decl);
+        if (values == undefined || values.length > elements || (dims.length > 1 && values.length != elements)) {
+            this.logWarning(`Could not read the elements of table ${decl.name}, keeping it in the code`);
+            return undefined;
+        }
+        const data = this.encode(values, elementType, elementSize, elements);
+        if (data == undefined) {
+            this.logWarning(`Table ${decl.name} has non-numeric elements, keeping it in the code`);
+            return undefined;
+        }
+
+        const binFile = this.getBinFileName(decl.name);
+        fs.writeFileSync(path.join(outputDir, binFile), data);
+
+        if (mode == TableEmissionMode.EMBED) {
+            decl.setInit(ClavaJoinPoints.exprLiteral(`{\n#embed "${binFile}"\n}`));
+        }
+        else {
+            decl.removeInit(false);
+            decl.setStorageClass(StorageClass.EXTERN);
+        }
+
+        this.log(`Exported table ${decl.name} (${elements} x ${elementType}) to ${binFile}`);
+        return { name: decl.name, elementType: elementType, elements: elements, bytes: data.length, binFile: binFile, mode: mode };
+    }
+
+    /**
+     * Encodes the elements of a table in little-endian, padding it with zeros up to the given number of elements.
+     * @returns undefined if any of the elements is not a numeric literal
+     */
+    public encode(values: string[], elementType: string, elementSize: number, elements: number): Buffer | undefined {
+        const data = Buffer.alloc(elements * elementSize);
+        const isFloat = elementType == "float" || elementType == "double";
+
+        for (let i = 0; i < values.length; i++) {
+            const offset = i * elementSize;
+
+            if (isFloat) {
+                const value = Number(values[i].replace(/[fFlL]$/, ""));
+                if (Number.isNaN(value)) {
+                    return undefined;
+                }
+                elementSize == 4 ? data.writeFloatLE(value, offset) : data.writeDoubleLE(value, offset);
+                continue;
+            }
+            const value = this.parseInteger(values[i]);
+            if (value == undefined) {
+                return undefined;
+            }
+            let unsigned = BigInt.asUintN(elementSize * 8, value);
+            for (let b = 0; b < elementSize; b++) {
+                data[offset + b] = Number(unsigned & 0xFFn);
+                unsigned >>= 8n;
+            }
+        }
+        return data;
+    }
+
+    private parseInteger(literal: string): bigint | undefined {
+        const negative = literal.startsWith("-");
+        let digits = literal.replace(/^[-+]/, "").replace(/[uUlL]+$/, "");
+
+        if (/^0[0-7]+$/.test(digits)) {
+            digits = `0o${digits.substring(1)}`;
+        }
+        if (!/^(0[xX][0-9a-fA-F]+|0[bB][01]+|0o[0-7]+|[0-9]+)$/.test(digits)) {
+            return undefined;
+        }
+        const value = BigInt(digits);
+        return negative ? -value : value;
+    }
+
+    private hasInternalLinkage(decl: Vardecl): boolean {
+        if (decl.storageClass === StorageClass.STATIC) {
+            return true;
+        }
+        // C++ gives namespace-scope const variables internal linkage, unless they are declared extern
+        return Clava.isCxx() && decl.storageClass !== StorageClass.EXTERN;
+    }
+
+    /**
+     * Same-named tables of different translation units can be embedded, so each one gets its own file
+     */
+    private getBinFileName(name: string): string {
+        let binFile = `${name}.bin`;
+        for (let i = 1; this.binFiles.has(binFile); i++) {
+            binFile = `${name}_${i}.bin`;
+        }
+        this.binFiles.add(binFile);
+        return binFile;
+    }
+
+    private getValues(decl: Vardecl): string[] | undefined {
+        const blob = InitializerBlobs.getBlob(decl);
+        if (blob != undefined) {
+            return blob.values;
+        }
+        if (!(decl.children[0] instanceof InitList)) {
+            return undefined;
+        }
+        return InitializerBlobs.parseElements(decl.children[0].code);
+    }
+
+    private getElementType(decl: Vardecl): string {
+        let type = AstPredicates.baseTypeOf(decl.type).desugarAll;
+        if (type instanceof QualType) {
+            type = type.unqualifiedType.desugarAll;
+        }
+        return type instanceof BuiltinType ? type.code.trim() : "";
+    }
+
+    private generateAssembly(tables: ExportedTable[]): string {
+        const lines = ["/* Constant tables exported from the woven code */", "    .section .rodata"];
+
+        for (const table of tables) {
+            lines.push(
+                "",
+                `    .global ${table.name}`,
+                `    .type ${table.name}, @object`,
+                "    .balign 16",
+                `${table.name}:`,
+                `    .incbin "${table.binFile}"`,
+                `    .size ${table.name}, .-${table.name}`
+            );
+        }
+        lines.push("", "    .section .note.GNU-stack,\"\",@progbits", "");
+        return lines.join("\n");
+    }
+}
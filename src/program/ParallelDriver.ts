@@ -0,0 +1,198 @@
+import { spawn } from "node:child_process";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { fileURLToPath } from "node:url";
+
+export type ParallelDriverOptions = {
+    // number of Clava processes running at the same time
+    workers?: number,
+    // function-local passes run by every worker (see ParallelWorker)
+    passes?: string[],
+    // extra Clava arguments, e.g., ["-std", "c11"]
+    clavaArgs?: string[],
+    // optional Clava script run once, serially, over the merged output
+    globalScript?: string,
+    // optional AnalysisCache directory, shared by the workers to reuse the loop characterizations of previous runs
+    cacheDir?: string,
+    clavaCommand?: string,
+    workerScript?: string
+}
+
+export type WorkerReport = {
+    partition: number,
+    files: string[],
+    success: boolean,
+    wallTimeMs: number,
+    counts: Record<string, number>,
+    log: string
+}
+
+export type ParallelReport = {
+    workers: WorkerReport[],
+    parallelTimeMs: number,
+    globalTimeMs: number,
+    outputDir: string
+}
+
+const SOURCE_EXTENSIONS = [".c", ".cpp", ".cc", ".cxx"];
+
+/**
+ * Runs function-local transforms over the translation units of a project in several Clava processes,
+ * merges their woven code, and then runs an optional global pass serially over the result.
+ * This is not a Clava script: it is meant to be run directly with node, and launches Clava itself.
+ * Headers are not transformed by the workers, and are copied as-is to the merged output.
+ */
+export class ParallelDriver {
+    private options: Required<ParallelDriverOptions>;
+
+    constructor(options: ParallelDriverOptions = {}) {
+        this.options = {
+            workers: Math.max(1, os.cpus().length),
+            passes: ["arrayflat-locals", "scopeflat", "loopchar"],
+            clavaArgs: [],
+            globalScript: "",
+            cacheDir: "",
+            clavaCommand: "npx",
+            workerScript: path.join(path.dirname(fileURLToPath(import.meta.url)), "ParallelWorker.js"),
+            ...options
+        };
+    }
+
+    public async run(inputDir: string, outputDir: string): Promise<ParallelReport> {
+        const sources = this.findFiles(inputDir).filter((file) => SOURCE_EXTENSIONS.includes(path.extname(file)));
+        const partitions = this.partition(inputDir, sources, this.options.workers);
+        const workDir = path.join(outputDir, "partitions");
+        const mergedDir = path.join(outputDir, "merged");
+
+        fs.rmSync(workDir, { recursive: true, force: true });
+        fs.rmSync(mergedDir, { recursive: true, force: true });
+        this.log(`Transforming ${sources.length} translation units in ${partitions.length} partitions`);
+
+        const parallelStart = Date.now();
+        const reports = await Promise.all(partitions.map((files, i) => this.runWorker(i, inputDir, files, workDir)));
+        const parallelTimeMs = Date.now() - parallelStart;
+
+        this.merge(inputDir, reports, workDir, mergedDir);
+
+        let globalTimeMs = 0;
+        let finalDir = mergedDir;
+        if (this.options.globalScript !== "") {
+            const globalStart = Date.now();
+            finalDir = path.join(outputDir, "final");
+            const result = await this.runClava(this.options.globalScript, mergedDir, finalDir, {});
+            globalTimeMs = Date.now() - globalStart;
+
+            if (result.code !== 0) {
+                this.log(`Global pass failed, keeping the merged output in ${mergedDir}:\n${result.log}`);
+                finalDir = mergedDir;
+            }
+        }
+
+        const failed = reports.filter((report) => !report.success);
+        this.log(`Workers finished in ${parallelTimeMs} ms (${failed.length} failed), global pass in ${globalTimeMs} ms`);
+        return { workers: reports, parallelTimeMs: parallelTimeMs, globalTimeMs: globalTimeMs, outputDir: finalDir };
+    }
+
+    /**
+     * Splits the files into at most n partitions of similar total size, largest files first.
+     */
+    public partition(inputDir: string, files: string[], n: number): string[][] {
+        const sizes = new Map(files.map((file) => [file, fs.statSync(path.join(inputDir, file)).size]));
+        const sorted = [...files].sort((a, b) => sizes.get(b)! - sizes.get(a)!);
+        const partitions: string[][] = Array.from({ length: Math.min(n, files.length) }, () => []);
+        const totals = partitions.map(() => 0);
+
+        for (const file of sorted) {
+            const smallest = totals.indexOf(Math.min(...totals));
+            partitions[smallest].push(file);
+            totals[smallest] += sizes.get(file)!;
+        }
+        return partitions;
+    }
+
+    private async runWorker(partition: number, inputDir: string, files: string[], workDir: string): Promise<WorkerReport> {
+        const partitionDir = path.join(workDir, `${partition}`, "src");
+        const partitionOut = path.join(workDir, `${partition}`, "out");
+
+        // headers are shared by every partition, so each one gets a copy of all of them
+        for (const file of this.findFiles(inputDir)) {
+            if (files.includes(file) || !SOURCE_EXTENSIONS.includes(path.extname(file))) {
+                this.copy(path.join(inputDir, file), path.join(partitionDir, file));
+            }
+        }
+
+        const start = Date.now();
+        const env: Record<string, string> = { CLAVA_PARALLEL_PASSES: this.options.passes.join(",") };
+        if (this.options.cacheDir !== "") {
+            env.CLAVA_ANALYSIS_CACHE = path.resolve(this.options.cacheDir);
+            env.CLAVA_PARALLEL_ARGS = JSON.stringify(this.options.clavaArgs);
+        }
+        const result = await this.runClava(this.options.workerScript, partitionDir, partitionOut, env);
+        const wallTimeMs = Date.now() - start;
+
+        const resultLine = result.log.split("\n").find((line) => line.startsWith("PARALLEL_WORKER_RESULT "));
+        const counts = resultLine != undefined ? JSON.parse(resultLine.substring("PARALLEL_WORKER_RESULT ".length)) : {};
+        const success = result.code === 0 && resultLine != undefined;
+
+        this.log(`Partition ${partition} (${files.length} files) ${success ? "done" : "FAILED"} in ${wallTimeMs} ms`);
+        return { partition: partition, files: files, success: success, wallTimeMs: wallTimeMs, counts: counts, log: result.log };
+    }
+
+    private merge(inputDir: string, reports: WorkerReport[], workDir: string, mergedDir: string): void {
+        for (const file of this.findFiles(inputDir)) {
+            if (!SOURCE_EXTENSIONS.includes(path.extname(file))) {
+                this.copy(path.join(inputDir, file), path.join(mergedDir, file));
+            }
+        }
+
+        for (const report of reports) {
+            const wovenDir = path.join(workDir, `${report.partition}`, "out", "woven_code");
+
+            for (const file of report.files) {
+                const woven = path.join(wovenDir, file);
+                // a failed partition keeps its original code, so the merged program is always complete
+                const source = report.success && fs.existsSync(woven) ? woven : path.join(inputDir, file);
+                this.copy(source, path.join(mergedDir, file));
+            }
+        }
+    }
+
+    private runClava(script: string, inputDir: string, outputDir: string, env: Record<string, string>): Promise<{ code: number, log: string }> {
+        const args = ["clava", "classic", script, "-p", inputDir, "-o", outputDir, ...this.options.clavaArgs];
+
+        return new Promise((resolve) => {
+            const child = spawn(this.options.clavaCommand, args, { env: { ...process.env, ...env } });
+            let log = "";
+
+            child.stdout.on("data", (data) => log += data.toString());
+            child.stderr.on("data", (data) => log += data.toString());
+            child.on("error", (err) => resolve({ code: -1, log: `${log}${err}` }));
+            child.on("close", (code) => resolve({ code: code ?? -1, log: log }));
+        });
+    }
+
+    private findFiles(dir: string, relative: string = ""): string[] {
+        const files: string[] = [];
+
+        for (const entry of fs.readdirSync(path.join(dir, relative), { withFileTypes: true })) {
+            const entryPath = path.join(relative, entry.name);
+            if (entry.isDirectory()) {
+                files.push(...this.findFiles(dir, entryPath));
+            }
+            else {
+                files.push(entryPath);
+            }
+        }
+        return files;
+    }
+
+    private copy(from: string, to: string): void {
+        fs.mkdirSync(path.dirname(to), { recursive: true });
+        fs.copyFileSync(from, to);
+    }
+
+    private log(msg: string): void {
+        console.log(`[ParallelDriver] ${msg}`);
+    }
+}
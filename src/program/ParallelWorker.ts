@@ -0,0 +1,71 @@
+import { FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ArrayFlattener } from "../flattening/ArrayFlattener.js";
+import { ScopeFlattener } from "../flattening/ScopeFlattener.js";
+import { LoopCharacterizer } from "../loop/LoopCharacterizer.js";
+import { AnalysisCache } from "./AnalysisCache.js";
+
+/**
+ * Clava script run by each ParallelDriver worker over its own partition of translation units.
+ * It only applies transforms whose result does not depend on other translation units,
+ * which are selected through the CLAVA_PARALLEL_PASSES environment variable.
+ * If CLAVA_ANALYSIS_CACHE is set, loop characterizations are taken from (and stored in) that AnalysisCache,
+ * under a stage named after the passes that run before them.
+ */
+const LOCAL_PASSES = ["arrayflat-locals", "scopeflat", "loopchar"];
+
+const passes = (process.env.CLAVA_PARALLEL_PASSES ?? LOCAL_PASSES.join(","))
+    .split(",")
+    .map((pass) => pass.trim())
+    .filter((pass) => pass.length > 0);
+
+const arrayFlattener = new ArrayFlattener(true);
+const scopeFlattener = new ScopeFlattener(true);
+const loopCharacterizer = new LoopCharacterizer(true);
+const counts: Record<string, number> = {};
+
+let cache: AnalysisCache | undefined = undefined;
+if (process.env.CLAVA_ANALYSIS_CACHE != undefined) {
+    cache = new AnalysisCache(process.env.CLAVA_ANALYSIS_CACHE, `parallel:${passes.slice(0, passes.indexOf("loopchar")).join(",")}`, undefined, true);
+    cache.setClavaArgs(JSON.parse(process.env.CLAVA_PARALLEL_ARGS ?? "[]"));
+}
+
+for (const fun of Query.search(FunctionJp, { isImplementation: true })) {
+    for (const pass of passes) {
+        let n = 0;
+        switch (pass) {
+            case "arrayflat-locals":
+                n = arrayFlattener.flattenLocalsInFunction(fun);
+                break;
+            case "scopeflat":
+                n = scopeFlattener.flattenAllInFunction(fun);
+                break;
+            case "loopchar": {
+                // the other passes neither add nor remove loops, so the cached ones are in the same order
+                const loops = Query.searchFrom(fun, Loop).get();
+                const characterizations = cache != undefined ?
+                    cache.getLoopCharacterizations(fun) :
+                    loops.map((loop) => loopCharacterizer.characterize(loop));
+
+                loops.forEach((loop, i) => {
+                    const characterization = characterizations[i];
+                    if (characterization != undefined && characterization.isValid) {
+                        loopCharacterizer.annotate(loop, characterization);
+                        n++;
+                    }
+                });
+                break;
+            }
+            default:
+                throw new Error(`Unknown function-local pass "${pass}", expected one of ${LOCAL_PASSES.join(", ")}`);
+        }
+        counts[pass] = (counts[pass] ?? 0) + n;
+    }
+}
+
+if (cache != undefined) {
+    counts["loopchar-cache-hits"] = cache.getStats().hitsByKind["loops"] ?? 0;
+}
+
+// parsed by ParallelDriver, keep it in a single line
+console.log(`PARALLEL_WORKER_RESULT ${JSON.stringify(counts)}`);
@@ -28,9 +28,21 @@ type ExprAndPos = {
     pos: ExprPos
 }
 
+/**
+ * What a loop (or any other region) does to its variables, computed once per region
+ * so that every legality check is a set lookup instead of a walk over the region
+ */
+type RegionSummary = {
+    writtenDecls: Set<string>,
+    addrPassedToCallDecls: Set<string>,
+    declaredDecls: Set<string>,
+    refCounts: Map<string, number>
+}
+
 export class VectorReduceSimplificator extends AdvancedTransform {
     currentModification: number = 0;
     safeToRemoveCache: Map<string, boolean> = new Map();
+    regionSummaries: Map<string, RegionSummary> = new Map();
 
     constructor(silent: boolean = false) {
         super("VectorReduceSimplificator", silent);
@@ -43,7 +55,8 @@ export class VectorReduceSimplificator extends AdvancedTransform {
         const replacements: VectorReduceSimplificationInfo[] = [];
 
         for (const loop of loopsToAnalyze) {
-            if (!(hasRegularControlFlow(loop, this.silent) && hasKnownInitValue(loop) && hasKnownEndValue(loop))) {
+            const summary = this.getSummary(loop);
+            if (!(hasRegularControlFlow(loop, this.getSummary(loop.body), this.silent) && hasKnownInitValue(loop) && hasKnownEndValue(loop))) {
                 continue;
             }
             for (const opAssign of Query.searchFrom(loop.body, BinaryOp, binop => binop.kind === "add_assign" || binop.kind === "sub_assign")) {
@@ -55,8 +68,7 @@ export class VectorReduceSimplificator extends AdvancedTransform {
 
                 const accumVar: Expression = opAssign.left;
                 if (!(accumVar instanceof Varref) || accumVar.vardecl === undefined) continue;
-                const accessesInsideLoop: Varref[] = Query.searchFrom(loop, Varref, varref => isVarrefOf(varref, accumVar.vardecl)).get();
-                if (accessesInsideLoop.length !== 1) continue;
+                if (summary.refCounts.get(accumVar.vardecl.astId) !== 1) continue;
 
                 const finalResultMultiplier = opAssign.kind === "add_assign" ? 1 : -1;
 
@@ -104,7 +116,9 @@ export class VectorReduceSimplificator extends AdvancedTransform {
                 });
             }
         }
+        // both caches refer to the AST before the transformations, so they cannot outlive this analysis
         this.safeToRemoveCache = new Map();
+        this.regionSummaries = new Map();
         this.applyTransformations(replacements);
 
         return this.currentModification;
@@ -112,6 +126,7 @@ export class VectorReduceSimplificator extends AdvancedTransform {
 
     private applyTransformations(transformations: VectorReduceSimplificationInfo[]): void {
         for (const transformation of transformations) {
+            this.markDirty(transformation.encompassingLoop);
             if (transformation.type === VectorReduceSimplificationType.COMPLETE) {
                 this.applyCompleteTransformation(
                     transformation.encompassingLoop,
@@ -200,55 +215,58 @@ export class VectorReduceSimplificator extends AdvancedTransform {
         return ClavaJoinPoints.binaryOp("mul", exprList[0].copy() as Expression, this.exprListToMultNode(exprList.slice(1)));
     }
 
+    private getSummary(region: Joinpoint): RegionSummary {
+        let summary = this.regionSummaries.get(region.astId);
+        if (summary === undefined) {
+            summary = summarizeRegion(region);
+            this.regionSummaries.set(region.astId, summary);
+        }
+        return summary;
+    }
+
     private canBeSafelyRemovedFromLoop(jp: Joinpoint, loop: Loop): boolean {
-        if (this.safeToRemoveCache.has(jp.astId)) return this.safeToRemoveCache.get(jp.astId)!;
+        // the same expression can be checked against different loops, so the loop is part of the key
+        const key = `${loop.astId}:${jp.astId}`;
+        if (this.safeToRemoveCache.has(key)) return this.safeToRemoveCache.get(key)!;
+
+        const safeToRemove = this.computeSafeToRemove(jp, loop);
+        this.safeToRemoveCache.set(key, safeToRemove);
+        return safeToRemove;
+    }
+
+    private computeSafeToRemove(jp: Joinpoint, loop: Loop): boolean {
+        const summary = this.getSummary(loop);
 
         if (jp instanceof Literal) {
-            this.safeToRemoveCache.set(jp.astId, true);
             return true;
         }
         else if (jp instanceof Varref) {
-            const isConstantInLoop: boolean = isConstantIn(jp, loop);
-            this.safeToRemoveCache.set(jp.astId, isConstantInLoop);
-            return isConstantInLoop;
+            return isConstantIn(jp, summary);
         }
         else if (jp instanceof BinaryOp) {
             if (jp.kind !== "mul") {
-                this.safeToRemoveCache.set(jp.astId, false);
                 return false;
             }
-
-            const safeToRemove = this.canBeSafelyRemovedFromLoop(jp.left, loop) && this.canBeSafelyRemovedFromLoop(jp.right, loop);
-            this.safeToRemoveCache.set(jp.astId, safeToRemove);
-            return safeToRemove;
+            return this.canBeSafelyRemovedFromLoop(jp.left, loop) && this.canBeSafelyRemovedFromLoop(jp.right, loop);
         }
         else if (jp instanceof ArrayAccess) {
             const innerCalls: Call[] = Query.searchFrom(jp, Call).get();
 
             if (innerCalls.length !== 0) {
-                this.safeToRemoveCache.set(jp.astId, false);
                 return false;
             }
 
             const innerVarrefs: Varref[] = Query.searchFrom(jp, Varref, varref => varref.vardecl !== undefined).get();
             for (const innerVarref of innerVarrefs) {
-                if (loop.contains(innerVarref.vardecl) || !isConstantIn(innerVarref, loop)) {
-                    this.safeToRemoveCache.set(jp.astId, false);
+                if (summary.declaredDecls.has(innerVarref.vardecl.astId) || !isConstantIn(innerVarref, summary)) {
                     return false;
                 }
             }
-
-            this.safeToRemoveCache.set(jp.astId, true);
             return true;
         }
         else if (jp instanceof ParenExpr) {
-            const isRemovable = this.canBeSafelyRemovedFromLoop(jp.subExpr, loop);
-
-            this.safeToRemoveCache.set(jp.astId, isRemovable);
-            return isRemovable;
+            return this.canBeSafelyRemovedFromLoop(jp.subExpr, loop);
         }
-
-        this.safeToRemoveCache.set(jp.astId, false);
         return false;
     }
 
@@ -258,11 +276,11 @@ export class VectorReduceSimplificator extends AdvancedTransform {
                 .searchFrom(loop.body, BinaryOp, binop => binop.kind === "add_assign" || binop.kind === "sub_assign")
                 .get().length !== 0) {
 
-                this.log(`Loop at [${loop.line}:${loop.column}] may be suitable for reduce simplification`);
+                this.logDebug(() => `Loop at [${loop.line}:${loop.column}] may be suitable for reduce simplification`);
                 return true;
             }
 
-            this.log(`Loop at [${loop.line}:${loop.column}] is not suitable for reduce simplification`);
+            this.logDebug(() => `Loop at [${loop.line}:${loop.column}] is not suitable for reduce simplification`);
             return false;
         }).get()
     }
@@ -294,13 +312,13 @@ function hasKnownInitValue(loop: Loop): boolean {
     return loop.initValue !== null && loop.initValue !== undefined;
 }
 
-function hasConstantPredictableStep(loop: Loop): boolean {
+function hasConstantPredictableStep(loop: Loop, bodySummary: RegionSummary): boolean {
     if (loop.controlVar === undefined || loop.controlVar === null) return false;
 
     if (!hasKnownIntStepValue(loop)) return false;
 
     if (loop.controlVarref === undefined || loop.controlVarref.vardecl === undefined) return false;
-    return isConstantIn(loop.controlVarref, loop.body);
+    return isConstantIn(loop.controlVarref, bodySummary);
 }
 
 function endValueIsConstant(loop: Loop, silent = true): boolean {
@@ -340,7 +358,7 @@ function endValueIsConstant(loop: Loop, silent = true): boolean {
     return true;
 }
 
-function hasRegularControlFlow(loop: Loop, silent = true): boolean {
+function hasRegularControlFlow(loop: Loop, bodySummary: RegionSummary, silent = true): boolean {
     let hasNoCustomControlFlow: boolean = Query.searchFrom(loop, Statement, altersControlFlow).get().length === 0;
 
     if (!hasNoCustomControlFlow) {
@@ -348,7 +366,7 @@ function hasRegularControlFlow(loop: Loop, silent = true): boolean {
         return false;
     }
 
-    if (!hasConstantPredictableStep(loop)) {
+    if (!hasConstantPredictableStep(loop, bodySummary)) {
         if (!silent) console.log(`\tLoop does not have constant predictable step`);
         return false;
     }
@@ -361,25 +379,46 @@ function hasRegularControlFlow(loop: Loop, silent = true): boolean {
     return true;
 }
 
-function isVarrefOf(varref: Varref, vardecl: Vardecl): boolean {
-    return varref.vardecl !== undefined && varref.vardecl !== null && varref.vardecl.astId === vardecl.astId;
-}
-
-function isConstantIn(varref: Varref, searchBaseJp: Joinpoint) {
-    if (varref.vardecl === undefined || varref.vardecl === null) return false; // probably a function varref
-
-    const vardecl: Vardecl = varref.vardecl;
-
-    const writes: Varref[] = Query.searchFromInclusive(searchBaseJp, Varref, innerVarref => {
-        return innerVarref.use !== "read" && isVarrefOf(innerVarref, vardecl);
-    }).get();
+/**
+ * Walks a region once, recording which declarations are written, have their address passed to a call,
+ * are declared inside it, and how many times each one is referenced
+ */
+function summarizeRegion(region: Joinpoint): RegionSummary {
+    const summary: RegionSummary = {
+        writtenDecls: new Set(),
+        addrPassedToCallDecls: new Set(),
+        declaredDecls: new Set(),
+        refCounts: new Map()
+    };
+
+    for (const varref of Query.searchFromInclusive(region, Varref, innerVarref => innerVarref.vardecl !== undefined && innerVarref.vardecl !== null)) {
+        const declId = varref.vardecl.astId;
+        summary.refCounts.set(declId, (summary.refCounts.get(declId) ?? 0) + 1);
+
+        if (varref.use !== "read") {
+            summary.writtenDecls.add(declId);
+        }
+    }
 
-    const ptrPassesToFunctions: Varref[] = Query.searchFromInclusive(searchBaseJp, Call)
+    const ptrPassesToFunctions: Varref[] = Query.searchFromInclusive(region, Call)
         .search(UnaryOp, { kind: "addr_of" })
-        .search(Varref, innerVarref => isVarrefOf(innerVarref, vardecl))
+        .search(Varref, innerVarref => innerVarref.vardecl !== undefined && innerVarref.vardecl !== null)
         .get();
+    for (const varref of ptrPassesToFunctions) {
+        summary.addrPassedToCallDecls.add(varref.vardecl.astId);
+    }
+
+    for (const vardecl of Query.searchFromInclusive(region, Vardecl)) {
+        summary.declaredDecls.add(vardecl.astId);
+    }
+    return summary;
+}
+
+function isConstantIn(varref: Varref, summary: RegionSummary) {
+    if (varref.vardecl === undefined || varref.vardecl === null) return false; // probably a function varref
 
-    return writes.length === 0 && ptrPassesToFunctions.length === 0;
+    const declId = varref.vardecl.astId;
+    return !summary.writtenDecls.has(declId) && !summary.addrPassedToCallDecls.has(declId);
 }
 
 function getFirstAncestorOf<T extends typeof Joinpoint>(
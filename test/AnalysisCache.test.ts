@@ -0,0 +1,98 @@
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FileJp, FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AnalysisCache } from "../src/program/AnalysisCache.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+const int SIZE = 16;
+int counter = 0;
+
+typedef struct {
+    int x;
+    float y;
+} point_t;
+
+void tick(void) {
+    counter++;
+}
+
+int sum(int *buf) {
+    int acc = 0;
+    for (int i = 0; i < 16; i++) {
+        acc += buf[i];
+    }
+    tick();
+    return acc;
+}
+`;
+
+describe("analysis cache", () => {
+    registerSourceCodeEach(source);
+    let cacheDir = "";
+
+    beforeEach(() => {
+        cacheDir = fs.mkdtempSync(path.join(os.tmpdir(), "analysis-cache-"));
+    });
+
+    afterEach(() => {
+        fs.rmSync(cacheDir, { recursive: true, force: true });
+    });
+
+    test("computes on the first run and reuses on the next one", () => {
+        const fun = Query.search(FunctionJp, { name: "sum" }).first()!;
+
+        const first = new AnalysisCache(cacheDir, "input", "test", true);
+        const loops = first.getLoopCharacterizations(fun);
+        const hash = first.hashProgram();
+        const names = first.getOrCompute("functions", hash, () => Query.search(FunctionJp).get().map((f) => f.name));
+        expect(first.getStats()).toMatchObject({ hits: 0, misses: 2 });
+
+        const second = new AnalysisCache(cacheDir, "input", "test", true);
+        expect(second.getLoopCharacterizations(fun)).toEqual(loops);
+        expect(second.getOrCompute("functions", hash, () => [])).toEqual(names);
+        expect(second.getStats()).toMatchObject({ hits: 2, misses: 0 });
+
+        expect(names).toEqual(["tick", "sum"]);
+        expect(loops[0].tripCount).toBe(16);
+    });
+
+    test("keeps stages and versions apart", () => {
+        const fun = Query.search(FunctionJp, { name: "sum" }).first()!;
+        new AnalysisCache(cacheDir, "input", "test", true).getLoopCharacterizations(fun);
+
+        const otherStage = new AnalysisCache(cacheDir, "after-flattening", "test", true);
+        const loops = otherStage.getLoopCharacterizations(fun);
+        const otherVersion = new AnalysisCache(cacheDir, "input", "test2", true);
+        otherVersion.getLoopCharacterizations(fun);
+
+        expect(otherStage.getStats().misses).toBe(1);
+        expect(otherVersion.getStats().misses).toBe(1);
+        expect(loops).toHaveLength(1);
+    });
+
+    test("keys translation units by their headers and the Clava arguments", () => {
+        const hashWithHeader = (header: string, args: string[]) => {
+            Clava.getProgram().push();
+            const program = Clava.getProgram();
+            program.addFile(ClavaJoinPoints.fileWithSource("unit.h", header));
+            program.addFile(ClavaJoinPoints.fileWithSource("unit.c", `#include "unit.h"\nint get(void) { return N; }\n`));
+            program.rebuild();
+
+            const cache = new AnalysisCache(cacheDir, "input", "test", true);
+            cache.setClavaArgs(args);
+            const hash = cache.hashFile(Query.search(FileJp, { name: "unit.c" }).first()!);
+            Clava.getProgram().pop();
+            return hash;
+        };
+        const hash = hashWithHeader("#define N 1\n", ["-std", "c11"]);
+
+        expect(hashWithHeader("#define N 1\n", ["-std", "c11"])).toBe(hash);
+        expect(hashWithHeader("#define N 2\n", ["-std", "c11"])).not.toBe(hash);
+        expect(hashWithHeader("#define N 1\n", ["-std", "c99"])).not.toBe(hash);
+    });
+});
@@ -0,0 +1,79 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { BinaryOp, FunctionJp, Statement, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { AstPredicates, CodeMaterializationCounter } from "../src/AstPredicates.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+typedef void nothing_t;
+
+nothing_t reset(int *buf) {
+    buf[0] = 0;
+}
+
+void *alloc(int n) {
+    return 0;
+}
+
+int loop(int *buf, int n) {
+    const int table[4][2] = {{0}};
+    int i = 0;
+    while (i < n) {
+        if (buf[i] == 0) {
+            break;
+        }
+        buf[i] = buf[i] + 1;
+        (buf[i]) = 2;
+        i++;
+    }
+    return i + table[0][0];
+}
+`;
+
+describe("structural predicates", () => {
+    registerSourceCodeEach(source);
+
+    test("detects breaks, including ones created as literals", () => {
+        const fun = Query.search(FunctionJp, { name: "loop" }).first()!;
+        const breaks = Query.searchFrom(fun, Statement).get().filter((stmt) => AstPredicates.isBreak(stmt));
+        expect(breaks).toHaveLength(1);
+
+        expect(AstPredicates.isBreak(ClavaJoinPoints.stmtLiteral("break;"))).toBe(true);
+        expect(AstPredicates.isContinue(ClavaJoinPoints.stmtLiteral("continue;"))).toBe(true);
+        expect(AstPredicates.isBreak(ClavaJoinPoints.stmtLiteral("continue;"))).toBe(false);
+    });
+
+    test("detects void types through typedefs, but not pointers to void", () => {
+        const reset = Query.search(FunctionJp, { name: "reset" }).first()!;
+        const alloc = Query.search(FunctionJp, { name: "alloc" }).first()!;
+
+        expect(AstPredicates.isVoidType(reset.returnType)).toBe(true);
+        expect(AstPredicates.isVoidType(alloc.returnType)).toBe(false);
+    });
+
+    test("finds the base type of arrays and qualified types", () => {
+        const table = Query.search(Vardecl, { name: "table" }).first()!;
+        expect(AstPredicates.baseTypeOf(table.type).code).toBe("int");
+    });
+
+    test("compares lvalues structurally", () => {
+        const fun = Query.search(FunctionJp, { name: "loop" }).first()!;
+        const assignments = Query.searchFrom(fun, BinaryOp, (op) => op.isAssignment).get();
+        const [first, second] = assignments.slice(-2);
+
+        expect(AstPredicates.isSameLvalue(first.left, second.left)).toBe(true);
+        expect(AstPredicates.isSameLvalue(first.left, first.right)).toBe(false);
+    });
+
+    test("counts .code accesses only while enabled", () => {
+        const fun = Query.search(FunctionJp, { name: "loop" }).first()!;
+        CodeMaterializationCounter.reset();
+        CodeMaterializationCounter.enable();
+        const codes = [fun.code, fun.body.code];
+        CodeMaterializationCounter.disable();
+        codes.push(fun.code);
+
+        expect(codes).toHaveLength(3);
+        expect(CodeMaterializationCounter.getCount()).toBe(2);
+    });
+});
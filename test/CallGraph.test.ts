@@ -0,0 +1,154 @@
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { Call, FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { CallGraph } from "../src/program/CallGraph.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+#include <stdlib.h>
+
+int leaf(int x) {
+    return x * 2;
+}
+
+int middle(int x) {
+    return leaf(x) + leaf(x + 1);
+}
+
+int unused(int x) {
+    return leaf(x);
+}
+
+int main() {
+    int *buf = (int *)malloc(sizeof(int));
+    buf[0] = middle(3);
+    free(buf);
+    return 0;
+}
+`;
+
+describe("call graph", () => {
+    registerSourceCodeEach(source);
+
+    test("finds reachable functions with the starting point first", () => {
+        const graph = CallGraph.get();
+        const names = graph.getReachable("main").map(fun => fun.name);
+
+        expect(names[0]).toBe("main");
+        expect(names).toContain("middle");
+        expect(names).toContain("leaf");
+        expect(names).not.toContain("unused");
+    });
+
+    test("indexes callers, call sites and calls to a function", () => {
+        const graph = CallGraph.get();
+
+        expect(graph.getCallers("leaf").map(fun => fun.name).sort()).toEqual(["middle", "unused"]);
+        expect(graph.getCallSites("middle")).toHaveLength(2);
+        expect(graph.getCallsTo("free")).toHaveLength(1);
+
+        const freeCall = Query.search(Call, { name: "free" }).first()!;
+        expect(graph.getCallerOf(freeCall)?.name).toBe("main");
+        expect(graph.isCallReachableFrom(freeCall, "main")).toBe(true);
+        expect(graph.isCallReachableFrom(freeCall, "middle")).toBe(false);
+    });
+
+    test("is reused until invalidated and updated incrementally on call removal", () => {
+        const graph = CallGraph.get();
+        expect(CallGraph.get()).toBe(graph);
+
+        const unused = Query.search(FunctionJp, { name: "unused" }).first()!;
+        const call = Query.searchFrom(unused, Call, { name: "leaf" }).first()!;
+        graph.removeCall(call);
+        expect(graph.getCallers("leaf").map(fun => fun.name)).toEqual(["middle"]);
+
+        CallGraph.invalidate();
+        expect(CallGraph.isValid()).toBe(false);
+        expect(CallGraph.get()).not.toBe(graph);
+    });
+});
+
+const recursiveSource = `
+int isOdd(int n);
+
+int isEven(int n) {
+    return n == 0 ? 1 : isOdd(n - 1);
+}
+
+int isOdd(int n) {
+    return n == 0 ? 0 : isEven(n - 1);
+}
+
+int fact(int n) {
+    return n <= 1 ? 1 : n * fact(n - 1);
+}
+
+int main() {
+    return isEven(4) + fact(3);
+}
+`;
+
+describe("call graph with recursion", () => {
+    registerSourceCodeEach(recursiveSource);
+
+    test("terminates on cycles and reports recursive components", () => {
+        const graph = CallGraph.get();
+        const names = graph.getReachable("main").map(fun => fun.name);
+        expect(names.sort()).toEqual(["fact", "isEven", "isOdd", "main"]);
+
+        const components = graph.getStronglyConnectedComponents("main");
+        expect(components[components.length - 1]).toEqual(["main"]);
+
+        const recursive = graph.getRecursiveComponents("main").map(component => component.sort());
+        expect(recursive).toHaveLength(2);
+        expect(recursive).toContainEqual(["isEven", "isOdd"]);
+        expect(recursive).toContainEqual(["fact"]);
+    });
+});
+
+const staticSource = `
+static int helper(int x) {
+    return x + 1;
+}
+
+int first(int x) {
+    return helper(x);
+}
+`;
+
+const otherStaticSource = `
+static int helper(int x) {
+    return x - 1;
+}
+
+int second(int x) {
+    return helper(x);
+}
+`;
+
+describe("call graph with same-named static functions", () => {
+    registerSourceCodeEach(staticSource);
+
+    test("keeps every implementation and walks from the given one", () => {
+        const program = Clava.getProgram();
+        program.addFile(ClavaJoinPoints.fileWithSource("otherFile.cpp", otherStaticSource));
+        program.rebuild();
+
+        const graph = CallGraph.get();
+        expect(graph.getFunctions().filter(fun => fun.name === "helper")).toHaveLength(2);
+
+        const [helper, otherHelper] = Query.search(FunctionJp, { name: "helper", isImplementation: true }).get();
+        const reachable = graph.getReachable(otherHelper);
+        expect(reachable).toHaveLength(1);
+        expect(reachable[0].astId).toBe(otherHelper.astId);
+
+        const second = Query.search(FunctionJp, { name: "second", isImplementation: true }).first()!;
+        const fromSecond = graph.getReachable(second);
+        expect(fromSecond.map(fun => fun.name)).toEqual(["second", "helper"]);
+        expect(fromSecond[1].astId).toBe(otherHelper.astId);
+        expect(fromSecond[1].astId).not.toBe(helper.astId);
+
+        expect(graph.getReachable("helper")).toHaveLength(2);
+    });
+});
@@ -0,0 +1,61 @@
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ChangeJournal } from "../src/ChangeJournal.js";
+import { ScopeFlattener } from "../src/flattening/ScopeFlattener.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int leaf(int x) {
+    int y = x;
+    {
+        int z = y + 1;
+        y = z;
+    }
+    return y;
+}
+
+int caller(int x) {
+    return leaf(x) + 1;
+}
+
+int untouched(int x) {
+    return x;
+}
+`;
+
+describe("change journal", () => {
+    registerSourceCodeEach(source);
+
+    const getFuns = () => Query.search(FunctionJp, { isImplementation: true }).get();
+
+    test("records the functions changed by a pass", () => {
+        const mark = ChangeJournal.mark();
+        const flattener = new ScopeFlattener(true);
+
+        for (const fun of getFuns()) {
+            flattener.flattenAllInFunction(fun);
+        }
+
+        expect(ChangeJournal.getDirtySince(mark)).toEqual(["leaf"]);
+        expect(ChangeJournal.isDirtySince("untouched", mark)).toBe(false);
+        expect(ChangeJournal.getChangesByTransform().get("ScopeFlattener")?.has("leaf")).toBe(true);
+    });
+
+    test("includes callers of changed functions when filtering", () => {
+        const mark = ChangeJournal.mark();
+        ChangeJournal.record("leaf", "Test");
+
+        const names = (funs: FunctionJp[]) => funs.map((fun) => fun.name).sort();
+        expect(names(ChangeJournal.filterDirty(getFuns(), mark))).toEqual(["caller", "leaf"]);
+        expect(names(ChangeJournal.filterDirty(getFuns(), mark, false))).toEqual(["leaf"]);
+    });
+
+    test("marks every function when a change is not local", () => {
+        const mark = ChangeJournal.mark();
+        ChangeJournal.recordAll("Test");
+
+        expect(ChangeJournal.getDirtySince(mark)).toBeUndefined();
+        expect(ChangeJournal.filterDirty(getFuns(), mark)).toHaveLength(3);
+        expect(ChangeJournal.getDirtySince(ChangeJournal.mark())).toEqual([]);
+    });
+});
@@ -5,6 +5,7 @@ import {
     GlobalConstantFolder,
 } from "../src/constfolding/ConstantFolder.js";
 import { GlobalConstantPropagator } from "../src/constfolding/ConstantPropagator.js";
+import { WorklistFoldingPropagation } from "../src/constfolding/WorklistFoldingPropagation.js";
 import { registerSourceCodeEach } from "./jestHelpers.js";
 
 const source = `
@@ -18,6 +19,15 @@ int calculate(void) {
 int read_limit(void) {
     return limit;
 }
+
+void chain(int *out) {
+    int a = 2 + 3;
+    int b;
+    int c;
+    b = a;
+    c = b * (limit - 1);
+    out[0] = c;
+}
 `;
 
 describe("constant folding and propagation", () => {
@@ -47,4 +57,16 @@ describe("constant folding and propagation", () => {
         expect(propagator.doPass()).toBe(1);
         expect(fun.code).toContain("return 7;");
     });
+
+    test("worklist engine reaches the fixed point in a single run", () => {
+        const fun = Query.search(FunctionJp, { name: "chain" }).first()!;
+        const worklist = new WorklistFoldingPropagation(true);
+
+        const stats = worklist.run(fun);
+        expect(stats.folds).toBeGreaterThanOrEqual(3);
+        expect(stats.funProps).toBeGreaterThanOrEqual(2);
+        expect(fun.code).toContain("out[0] = 30;");
+
+        expect(new WorklistFoldingPropagation(true).run(fun).folds).toBe(0);
+    });
 });
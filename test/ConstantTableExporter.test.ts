@@ -0,0 +1,80 @@
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { StorageClass, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ConstantTableExporter, TableEmissionMode } from "../src/program/ConstantTableExporter.js";
+import { InitializerBlobs } from "../src/InitializerBlobs.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+extern const int table[40] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39};
+const unsigned char bytes[2][3] = {{1, 2, 3}, {4, 5, 255}};
+const int tiny[2] = {1, 2};
+const int internal_table[40] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39};
+int mutable_table[40] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39};
+
+int lookup(int i) {
+    return table[i] + bytes[1][i] + tiny[0] + internal_table[i] + mutable_table[i];
+}
+`;
+
+describe("constant table exporter", () => {
+    registerSourceCodeEach(source);
+    let outputDir: string;
+
+    beforeEach(() => {
+        InitializerBlobs.clear();
+        outputDir = fs.mkdtempSync(path.join(os.tmpdir(), "tables-"));
+    });
+
+    afterEach(() => {
+        fs.rmSync(outputDir, { recursive: true, force: true });
+    });
+
+    test("encodes integers in little-endian, padded with zeros", () => {
+        const exporter = new ConstantTableExporter({}, true);
+        const data = exporter.encode(["1", "-1", "0x10"], "short", 2, 4)!;
+
+        expect(Array.from(data)).toEqual([1, 0, 255, 255, 16, 0, 0, 0]);
+        expect(exporter.encode(["1", "SOME_MACRO"], "int", 4, 2)).toBeUndefined();
+    });
+
+    test("moves large constant tables to binary files and an assembly file", () => {
+        const exported = new ConstantTableExporter({ minBytes: 100 }, true).exportAll(outputDir);
+
+        expect(exported.map((table) => table.name)).toEqual(["table"]);
+        expect(fs.statSync(path.join(outputDir, "table.bin")).size).toBe(160);
+        expect(fs.readFileSync(path.join(outputDir, "constant_tables.S"), "utf8")).toContain(".incbin \"table.bin\"");
+
+        const table = Query.search(Vardecl, { name: "table" }).first()!;
+        expect(table.hasInit).toBe(false);
+        expect(table.storageClass).toBe(StorageClass.EXTERN);
+        expect(Query.search(Vardecl, { name: "mutable_table" }).first()!.hasInit).toBe(true);
+        expect(Query.search(Vardecl, { name: "internal_table" }).first()!.hasInit).toBe(true);
+    });
+
+    test("embeds byte tables in place", () => {
+        const exported = new ConstantTableExporter({ minBytes: 4, mode: TableEmissionMode.EMBED }, true).exportAll(outputDir);
+        const byMode = Object.fromEntries(exported.map((table) => [table.name, table.mode]));
+
+        expect(byMode["bytes"]).toBe(TableEmissionMode.EMBED);
+        expect(byMode["table"]).toBe(TableEmissionMode.INCBIN);
+        expect(Array.from(fs.readFileSync(path.join(outputDir, "bytes.bin")))).toEqual([1, 2, 3, 4, 5, 255]);
+        expect(Query.search(Vardecl, { name: "bytes" }).first()!.code).toContain("#embed \"bytes.bin\"");
+    });
+
+    test("gives same-named embedded tables of different files their own binary files", () => {
+        const program = Clava.getProgram();
+        program.addFile(ClavaJoinPoints.fileWithSource("otherFile.cpp", "static const unsigned char bytes[4] = {9, 8, 7, 6};\n"));
+        program.rebuild();
+
+        const exported = new ConstantTableExporter({ minBytes: 4, mode: TableEmissionMode.EMBED }, true).exportAll(outputDir);
+        const binFiles = exported.filter((table) => table.name == "bytes").map((table) => table.binFile).sort();
+
+        expect(binFiles).toEqual(["bytes.bin", "bytes_1.bin"]);
+        expect(exported.map((table) => table.name)).not.toContain("internal_table");
+    });
+});
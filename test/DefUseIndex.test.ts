@@ -0,0 +1,60 @@
+import { FunctionJp, Param, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { DefUseIndex } from "../src/function/DefUseIndex.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int g;
+
+int global(void) {
+    g = 1;
+    {
+        int g;
+    }
+    return g;
+}
+
+int shadow(int *p, int n) {
+    int x = n;
+    {
+        int x = 2;
+        x++;
+    }
+    p = p + x;
+    return *p;
+}
+`;
+
+describe("def-use index", () => {
+    registerSourceCodeEach(source);
+
+    test("separates the references of declarations with the same name", () => {
+        const fun = Query.search(FunctionJp, { name: "shadow" }).first()!;
+        const index = new DefUseIndex(fun);
+        const [outer, inner] = Query.searchFrom(fun, Vardecl, { name: "x" }).get();
+
+        expect(index.getRefsOf(outer)).toHaveLength(1);
+        expect(index.getRefsOf(inner)).toHaveLength(1);
+        expect(index.isReassigned(outer)).toBe(false);
+        expect(index.isReassigned(inner)).toBe(true);
+    });
+
+    test("falls back to names for references linked to declarations outside of it", () => {
+        const fun = Query.search(FunctionJp, { name: "shadow" }).first()!;
+        const clone = fun.clone("shadow_clone");
+        const index = new DefUseIndex(clone);
+        const param = Query.searchFrom(clone, Param, { name: "p" }).first()!;
+
+        expect(index.getRefsOf(param).length).toBe(3);
+        expect(index.isReassigned(param)).toBe(true);
+    });
+
+    test("does not take references to globals by name", () => {
+        const fun = Query.search(FunctionJp, { name: "global" }).first()!;
+        const index = new DefUseIndex(fun);
+        const local = Query.searchFrom(fun, Vardecl, { name: "g" }).first()!;
+
+        expect(index.getRefsOf(local)).toHaveLength(0);
+        expect(index.getRefs("g")).toHaveLength(2);
+    });
+});
@@ -0,0 +1,84 @@
+import { Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { IndexStrengthReducer } from "../src/loop/IndexStrengthReducer.js";
+import { getFunction, registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+void blur_rows(float *b, const float *a) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 63; j++) {
+            if (a[i * 64 + j] < 0.0f) {
+                continue;
+            }
+            b[i * 64 + j] = a[i * 64 + j] + a[i * 64 + j + 1];
+        }
+    }
+}
+
+float column(const float *a, int c) {
+    float s = 0.0f;
+    int r;
+    for (r = 0; r < 32; r++) {
+        s += a[r * 64 + c];
+    }
+    return s + r;
+}
+
+void parallel_rows(float *b, const float *a) {
+    for (int i = 0; i < 32; i++) {
+        #pragma omp parallel for
+        for (int j = 0; j < 64; j++) {
+            b[i * 64 + j] = a[i * 64 + j];
+        }
+    }
+}
+
+void unit(float *a) {
+    for (int j = 0; j < 64; j++) {
+        a[j + 1] = 0.0f;
+    }
+}
+`;
+
+describe("index strength reduction", () => {
+    registerSourceCodeEach(source);
+
+    test("shares one running offset among accesses that differ by a constant", () => {
+        const fun = getFunction("blur_rows");
+        const reducer = new IndexStrengthReducer(true);
+
+        expect(reducer.reduceAllInFunction(fun)).toBe(1);
+        const code = fun.code;
+        expect(code).toMatch(/int (j_offset\w*) = i \* 64 \+ 0;/);
+        expect(code).toMatch(/j\+\+, j_offset\w* \+= 1\)/);
+        expect(code).toMatch(/b\[j_offset\w*\] = a\[j_offset\w*\] \+ a\[j_offset\w* \+ 1\]/);
+        expect(code).not.toContain("i * 64 + j");
+    });
+
+    test("reduces non-unit strides and keeps the induction variable for the loop exit", () => {
+        const fun = getFunction("column");
+        const reducer = new IndexStrengthReducer(true);
+
+        expect(reducer.reduce(Query.searchFrom(fun, Loop).first()!)).toBe(1);
+        const code = fun.code;
+        expect(code).toMatch(/int r_offset\w* = 0 \* 64 \+ c;/);
+        expect(code).toMatch(/r\+\+, r_offset\w* \+= 64\)/);
+        expect(code).toContain("return s + r;");
+    });
+
+    test("leaves subscripts without multiplications as they are", () => {
+        const fun = getFunction("unit");
+        const reducer = new IndexStrengthReducer(true);
+
+        expect(reducer.reduceAllInFunction(fun)).toBe(0);
+        expect(fun.code).toContain("a[j + 1]");
+    });
+
+    test("leaves loops with pragmas as they are", () => {
+        const fun = getFunction("parallel_rows");
+        const reducer = new IndexStrengthReducer(true);
+
+        expect(reducer.reduceAllInFunction(fun)).toBe(0);
+        expect(fun.code).toMatch(/#pragma omp parallel for\s*for \(int j = 0; j < 64; j\+\+\)/);
+    });
+});
@@ -0,0 +1,159 @@
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FunctionJp, InitList, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ConstantArrayPropagator } from "../src/constfolding/ConstantArrayPropagator.js";
+import { ArrayFlattener } from "../src/flattening/ArrayFlattener.js";
+import { InitializerBlobs } from "../src/InitializerBlobs.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+// element [i][j] of table is 3 * (i * 10 + j)
+const source = `
+const int table[6][10] = {{0, 3, 6, 9, 12, 15, 18, 21, 24, 27}, {30, 33, 36, 39, 42, 45, 48, 51, 54, 57}, {60, 63, 66, 69, 72, 75, 78, 81, 84, 87}, {90, 93, 96, 99, 102, 105, 108, 111, 114, 117}, {120, 123, 126, 129, 132, 135, 138, 141, 144, 147}, {150, 153, 156, 159, 162, 165, 168, 171, 174, 177}};
+int small[3] = {1, 2, 3};
+
+int lookup(int i) {
+    return table[2][5] + table[i][1] + small[0];
+}
+
+int shadowed(int c) {
+    if (c) {
+        const int t[6] = {1, 2, 3, 4, 5, 6};
+        return t[0];
+    }
+    else {
+        const int t[6] = {7, 8, 9, 10, 11, 12};
+        return t[0];
+    }
+}
+`;
+
+const otherSource = `
+static const int table[60] = {5, 6, 7, 8, 9, 10};
+
+int other_lookup(void) {
+    return table[5] + table[50];
+}
+`;
+
+describe("initializer blobs", () => {
+    registerSourceCodeEach(source);
+
+    beforeEach(() => {
+        InitializerBlobs.clear();
+    });
+
+    test("compacts only the initializers above the threshold", () => {
+        expect(InitializerBlobs.compactAll(5)).toBe(1);
+
+        const table = Query.search(Vardecl, { name: "table" }).first()!;
+        const small = Query.search(Vardecl, { name: "small" }).first()!;
+        expect((table.children[0] as InitList).numChildren).toBe(1);
+        expect(InitializerBlobs.isBlob(table)).toBe(true);
+        expect(InitializerBlobs.isBlob(small)).toBe(false);
+        expect(InitializerBlobs.getStats().elements).toBe(60);
+        expect(table.code).toContain("177");
+    });
+
+    test("finds elements in row-major order", () => {
+        InitializerBlobs.compactAll(5);
+        const blob = InitializerBlobs.getBlob(Query.search(Vardecl, { name: "table" }).first()!)!;
+
+        expect(blob.isConst).toBe(true);
+        expect(InitializerBlobs.elementAt(blob, [2, 5])).toBe("75");
+        expect(InitializerBlobs.elementAt(blob, [6, 0])).toBeUndefined();
+        expect(InitializerBlobs.elementAt(blob, [1])).toBeUndefined();
+    });
+
+    test("propagates reads with literal subscripts only", () => {
+        InitializerBlobs.compactAll(5);
+        const fun = Query.search(FunctionJp, { name: "lookup" }).first()!;
+
+        expect(new ConstantArrayPropagator(true).doPass(fun)).toBe(1);
+        expect(fun.code).toContain("return 75 + table[i][1]");
+    });
+
+    test("flattens blobs from their elements", () => {
+        InitializerBlobs.compactAll(5);
+        new ArrayFlattener(true).flattenAll();
+
+        const table = Query.search(Vardecl, { name: "table" }).first()!;
+        const blob = InitializerBlobs.getBlob(table)!;
+        expect(blob.dims).toEqual([60]);
+        expect(InitializerBlobs.elementAt(blob, [25])).toBe("75");
+        expect(table.code).not.toMatch(/\{\s*\{/);
+    });
+
+    test("does not compact declarations that share a key", () => {
+        InitializerBlobs.compactAll(5);
+        const [first, second] = Query.search(Vardecl, { name: "t" }).get();
+
+        expect(InitializerBlobs.isBlob(first)).toBe(false);
+        expect(InitializerBlobs.isBlob(second)).toBe(false);
+        expect((first.children[0] as InitList).numChildren).toBe(6);
+    });
+
+    test("keeps the blobs of same-named tables in different files apart", () => {
+        const program = Clava.getProgram();
+        program.addFile(ClavaJoinPoints.fileWithSource("otherFile.cpp", otherSource));
+        program.rebuild();
+
+        expect(InitializerBlobs.compactAll(5)).toBe(2);
+        const [table, otherTable] = Query.search(Vardecl, { name: "table" }).get();
+        expect(InitializerBlobs.keyOf(table)).not.toBe(InitializerBlobs.keyOf(otherTable));
+
+        const fun = Query.search(FunctionJp, { name: "other_lookup" }).first()!;
+        new ConstantArrayPropagator(true).doPass(fun);
+        expect(fun.code).toContain("return 10 + 0;");
+    });
+});
+
+const typedSource = `
+typedef unsigned long long u64;
+
+const u64 masks[6] = {1, 2, 3, 4, 5, 6};
+const float weights[6] = {0.5, 0.25, 0.125, 1.5, 2.5, 3.5};
+const int table[6][2] = {{10, 11}, {12, 13}, {14, 15}, {16, 17}, {18, 19}, {20, 21}};
+
+u64 high_mask(void) {
+    return masks[0] << 40;
+}
+
+float weigh(float x) {
+    return weights[1] * x;
+}
+
+unsigned long element_size(void) {
+    const int *p = &table[1][1];
+    return sizeof(table[0][0]) + *p;
+}
+`;
+
+describe("constant array propagation", () => {
+    registerSourceCodeEach(typedSource);
+
+    beforeEach(() => {
+        InitializerBlobs.clear();
+    });
+
+    test("keeps the element type of the values", () => {
+        InitializerBlobs.compactAll(5);
+        const propagator = new ConstantArrayPropagator(true);
+        const highMask = Query.search(FunctionJp, { name: "high_mask" }).first()!;
+        const weigh = Query.search(FunctionJp, { name: "weigh" }).first()!;
+
+        expect(propagator.doPass(highMask)).toBe(1);
+        expect(propagator.doPass(weigh)).toBe(1);
+        expect(highMask.code).toMatch(/return \(u64\)\s*1 << 40;/);
+        expect(weigh.code).toMatch(/return \(float\)\s*0\.25 \* x;/);
+    });
+
+    test("leaves the operands of & and sizeof as they are", () => {
+        InitializerBlobs.compactAll(5);
+        const fun = Query.search(FunctionJp, { name: "element_size" }).first()!;
+
+        expect(new ConstantArrayPropagator(true).doPass(fun)).toBe(0);
+        expect(fun.code).toContain("&table[1][1]");
+        expect(fun.code).toContain("sizeof(table[0][0])");
+    });
+});
@@ -0,0 +1,102 @@
+import { Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { LoopCollapser } from "../src/loop/LoopCollapser.js";
+import { getFunction, registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+void clear(int *frame_buffer) {
+    for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 256; j++) {
+            frame_buffer[i * 256 + j] = 0;
+        }
+    }
+}
+
+int sum_cube(const int *cube) {
+    int sum = 0;
+    int i, j;
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            for (int k = 0; k < 16; k++) {
+                sum += cube[(i * 8 + j) * 16 + k];
+            }
+        }
+    }
+    return sum + i + j;
+}
+
+void crop(int *dst, const int *src) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 30; j++) {
+            dst[i * 30 + j] = src[i * 32 + j];
+        }
+    }
+}
+
+void diagonal(int *m) {
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) {
+            m[i * 16 + j] = i == j;
+        }
+    }
+}
+
+void clear_until_zero(int *frame_buffer) {
+    for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 256; j++) {
+            if (frame_buffer[i * 256 + j] == 0) break;
+            frame_buffer[i * 256 + j] = 0;
+        }
+    }
+}
+
+void clear_nonzero(int *frame_buffer) {
+    for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 256; j++) {
+            if (frame_buffer[i * 256 + j] == 0) continue;
+            frame_buffer[i * 256 + j] = 0;
+        }
+    }
+}
+`;
+
+describe("loop collapsing", () => {
+    registerSourceCodeEach(source);
+
+    test("collapses a nest over a whole flattened array", () => {
+        const fun = getFunction("clear");
+        const collapser = new LoopCollapser(true);
+
+        expect(collapser.collapseAllInFunction(fun)).toBe(1);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(1);
+        const code = fun.code;
+        expect(code).toMatch(/for\s*\(int (i_j\w*) = 0; \1 < 65536; \1\+\+\)/);
+        expect(code).toMatch(/frame_buffer\[i_j\w*\] = 0;/);
+    });
+
+    test("collapses deeper nests and keeps the final values of the induction variables", () => {
+        const fun = getFunction("sum_cube");
+        const collapser = new LoopCollapser(true);
+
+        expect(collapser.collapse(Query.searchFrom(fun, Loop).first()!)).toBe(3);
+        const code = fun.code;
+        expect(code).toMatch(/i_j_k\w* < 512/);
+        expect(code).toMatch(/cube\[i_j_k\w*\]/);
+        expect(code).toContain("i = 4;");
+        expect(code).toContain("j = 8;");
+    });
+
+    test("does not collapse loops that skip part of a row or use the induction variables", () => {
+        const collapser = new LoopCollapser(true);
+
+        expect(collapser.collapseAllInFunction(getFunction("crop"))).toBe(0);
+        expect(collapser.collapseAllInFunction(getFunction("diagonal"))).toBe(0);
+    });
+
+    test("does not collapse nests with breaks out of their loops, but allows continues", () => {
+        const collapser = new LoopCollapser(true);
+
+        expect(collapser.collapseAllInFunction(getFunction("clear_until_zero"))).toBe(0);
+        expect(collapser.collapseAllInFunction(getFunction("clear_nonzero"))).toBe(1);
+    });
+});
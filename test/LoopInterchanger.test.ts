@@ -0,0 +1,76 @@
+import { FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { LoopInterchanger } from "../src/loop/LoopInterchanger.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+void scale_columns(float *__restrict b, const float *__restrict a) {
+    for (int j = 0; j < 64; j++) {
+        for (int i = 0; i < 32; i++) {
+            b[i * 64 + j] = a[i * 64 + j] * 2.0f;
+        }
+    }
+}
+
+void permute3d(int *__restrict dst, const int *__restrict src) {
+    for (int k = 0; k < 16; k++) {
+        for (int j = 0; j < 8; j++) {
+            for (int i = 0; i < 4; i++) {
+                dst[(i * 8 + j) * 16 + k] = src[(i * 8 + j) * 16 + k] + 1;
+            }
+        }
+    }
+}
+
+void row_major(float *__restrict b, const float *__restrict a) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 64; j++) {
+            b[i * 64 + j] = a[i * 64 + j];
+        }
+    }
+}
+
+void prefix_columns(float *__restrict a) {
+    for (int j = 0; j < 64; j++) {
+        for (int i = 1; i < 32; i++) {
+            a[i * 64 + j] = a[(i - 1) * 64 + j] + a[i * 64 + j];
+        }
+    }
+}
+`;
+
+function outerLoop(name: string): Loop {
+    return Query.searchFrom(Query.search(FunctionJp, { name: name }).first()!, Loop).first()!;
+}
+
+function inductionVars(name: string): string[] {
+    return Query.searchFrom(Query.search(FunctionJp, { name: name }).first()!, Loop).get()
+        .map((loop) => loop.children[0].code.match(/int (\w+)/)![1]);
+}
+
+describe("loop interchange", () => {
+    registerSourceCodeEach(source);
+
+    test("makes column-major walks row-major", () => {
+        const interchanger = new LoopInterchanger(true);
+
+        expect(interchanger.interchange(outerLoop("scale_columns"))).toBe(true);
+        expect(inductionVars("scale_columns")).toEqual(["i", "j"]);
+        expect(Query.search(FunctionJp, { name: "scale_columns" }).first()!.code).toContain("b[i * 64 + j] = a[i * 64 + j] * 2.0f;");
+    });
+
+    test("orders deeper nests by decreasing stride", () => {
+        const interchanger = new LoopInterchanger(true);
+
+        expect(interchanger.interchange(outerLoop("permute3d"))).toBe(true);
+        expect(inductionVars("permute3d")).toEqual(["i", "j", "k"]);
+    });
+
+    test("leaves unit-stride and dependent nests as they are", () => {
+        const interchanger = new LoopInterchanger(true);
+
+        expect(interchanger.interchange(outerLoop("row_major"))).toBe(false);
+        expect(interchanger.interchange(outerLoop("prefix_columns"))).toBe(false);
+        expect(inductionVars("prefix_columns")).toEqual(["j", "i"]);
+    });
+});
@@ -0,0 +1,157 @@
+import { ArrayAccess, FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { LoopNestAnalyzer } from "../src/loop/LoopNestAnalyzer.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+void copy3d(int *__restrict dst, const int *__restrict src) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 8; j++) {
+            for (int k = 0; k < 16; k++) {
+                dst[(i * 8 + j) * 16 + k] = src[(i * 8 + j) * 16 + k];
+            }
+        }
+    }
+}
+
+void shift(int *__restrict a) {
+    for (int i = 1; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            a[i * 32 + j] = a[(i - 1) * 32 + j];
+        }
+    }
+}
+
+void overlap(int *__restrict a) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            a[i + j] = 0;
+        }
+    }
+}
+
+void row_sums(int *__restrict sums, const int *__restrict m) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            sums[i] += m[i * 32 + j];
+        }
+    }
+}
+
+int total(const int *__restrict m) {
+    int t = 0;
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            t += m[i * 32 + j];
+        }
+    }
+    return t;
+}
+
+void clamp_until_negative(int *__restrict a) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            if (a[i * 32 + j] < 0) break;
+            a[i * 32 + j] = 0;
+        }
+    }
+}
+
+void clear_rows(int *__restrict a, const int *__restrict lens) {
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            for (int k = 0; k < 32; k++) {
+                if (k == lens[k]) break;
+            }
+            a[i * 32 + j] = 0;
+        }
+    }
+}
+
+void plain_transpose(float *out, const float *in) {
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            out[i * 64 + j] = in[j * 64 + i];
+        }
+    }
+}
+
+void transpose_in_place(int *__restrict a) {
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            a[i * 64 + j] = *(a + j * 64 + i);
+        }
+    }
+}
+
+int local_copy(int k) {
+    int buf[1024];
+    int *p = buf;
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            buf[i * 32 + j] = p[j * 32 + i];
+        }
+    }
+    return buf[k];
+}
+
+int local_fill(int k) {
+    int buf[1024];
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            buf[i * 32 + j] = i + j;
+        }
+    }
+    return buf[k];
+}
+`;
+
+function outerLoop(name: string): Loop {
+    return Query.searchFrom(Query.search(FunctionJp, { name: name }).first()!, Loop).first()!;
+}
+
+describe("loop nest analysis", () => {
+    registerSourceCodeEach(source);
+
+    test("finds perfect nests and the strides of flattened subscripts", () => {
+        const analyzer = new LoopNestAnalyzer(true);
+        const nest = analyzer.getPerfectNest(outerLoop("copy3d"))!;
+        expect(nest.map((counted) => counted.inductionVar)).toEqual(["i", "j", "k"]);
+
+        const access = Query.searchFrom(nest[2].loop.body, ArrayAccess).first()!;
+        const form = analyzer.toAffine(access.children[1])!;
+        expect(analyzer.getStride(form, "i")).toBe(128);
+        expect(analyzer.getStride(form, "j")).toBe(16);
+        expect(analyzer.getStride(form, "k")).toBe(1);
+        expect(analyzer.getStride(form, "n")).toBe(0);
+    });
+
+    test("only lets nests without carried dependences be reordered", () => {
+        const analyzer = new LoopNestAnalyzer(true);
+        const check = (name: string) => analyzer.checkReordering(analyzer.getPerfectNest(outerLoop(name))!);
+
+        expect(check("copy3d")).toBeUndefined();
+        expect(check("row_sums")).toBeUndefined();
+        expect(check("shift")).toContain("different subscripts");
+        expect(check("overlap")).toContain("same element");
+        expect(check("total")).toContain("variable t");
+    });
+
+    test("does not let nests with breaks out of their loops be reordered", () => {
+        const analyzer = new LoopNestAnalyzer(true);
+        const check = (name: string) => analyzer.checkReordering(analyzer.getPerfectNest(outerLoop(name))!);
+
+        expect(check("clamp_until_negative")).toContain("break");
+        expect(check("clear_rows")).toBeUndefined();
+    });
+
+    test("only lets nests that write to unaliased arrays be reordered", () => {
+        const analyzer = new LoopNestAnalyzer(true);
+        const check = (name: string) => analyzer.checkReordering(analyzer.getPerfectNest(outerLoop(name))!);
+
+        expect(check("plain_transpose")).toContain("may alias");
+        expect(check("transpose_in_place")).toContain("without a subscript");
+        expect(check("local_copy")).toContain("without a subscript");
+        expect(check("local_fill")).toBeUndefined();
+    });
+});
@@ -0,0 +1,101 @@
+import { Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { LoopTiler } from "../src/loop/LoopTiler.js";
+import { getFunction, registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+void transpose(float *__restrict out, const float *__restrict in) {
+    for (int i = 0; i < 100; i++) {
+        for (int j = 0; j < 64; j++) {
+            out[i * 64 + j] = in[j * 100 + i];
+        }
+    }
+}
+
+void increment(float *__restrict a) {
+    #pragma clava tile 16 8
+    for (int r = 0; r < 64; r++) {
+        for (int c = 0; c < 64; c++) {
+            a[r * 64 + c] = a[r * 64 + c] + 1.0f;
+        }
+    }
+}
+
+void smooth(float *__restrict a) {
+    for (int i = 1; i < 63; i++) {
+        for (int j = 1; j < 63; j++) {
+            a[i * 64 + j] = a[(i - 1) * 64 + j] + a[i * 64 + j - 1];
+        }
+    }
+}
+
+void clear_until_negative(float *__restrict a) {
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            if (a[i * 64 + j] < 0) break;
+            a[i * 64 + j] = 0;
+        }
+    }
+}
+
+void plain_transpose(float *out, const float *in) {
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            out[i * 64 + j] = in[j * 64 + i];
+        }
+    }
+}
+`;
+
+describe("loop tiling", () => {
+    registerSourceCodeEach(source);
+
+    test("tiles a perfect nest, clamping only the point loops with a remainder", () => {
+        const fun = getFunction("transpose");
+        const tiler = new LoopTiler({ tileSizes: [32, 32] }, true);
+
+        expect(tiler.tile(Query.searchFrom(fun, Loop).first()!)).toBe(true);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(4);
+        const code = fun.code;
+        expect(code).toMatch(/i_tile\w* < 100/);
+        expect(code).toMatch(/i_tile\w* \+= 32/);
+        expect(code).toMatch(/i = i_tile\w*/);
+        expect(code).toMatch(/i < \(i_tile\w* \+ 32 < 100 \? i_tile\w* \+ 32 : 100\)/);
+        expect(code).toMatch(/j < j_tile\w* \+ 32;/);
+    });
+
+    test("takes the tile sizes from pragmas", () => {
+        const fun = getFunction("increment");
+        const tiler = new LoopTiler({}, true);
+
+        expect(tiler.tileAnnotatedInFunction(fun)).toBe(1);
+        const code = fun.code;
+        expect(code).not.toContain("#pragma clava tile");
+        expect(code).toMatch(/r_tile\w* \+= 16/);
+        expect(code).toMatch(/c_tile\w* \+= 8/);
+    });
+
+    test("does not tile nests with loop-carried dependences", () => {
+        const fun = getFunction("smooth");
+        const tiler = new LoopTiler({}, true);
+
+        expect(tiler.tileAllInFunction(fun)).toBe(0);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(2);
+    });
+
+    test("does not tile nests that write through pointers that may alias", () => {
+        const fun = getFunction("plain_transpose");
+        const tiler = new LoopTiler({}, true);
+
+        expect(tiler.tileAllInFunction(fun)).toBe(0);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(2);
+    });
+
+    test("does not tile nests with breaks out of their loops", () => {
+        const fun = getFunction("clear_until_negative");
+        const tiler = new LoopTiler({}, true);
+
+        expect(tiler.tileAllInFunction(fun)).toBe(0);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(2);
+    });
+});
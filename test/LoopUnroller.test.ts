@@ -0,0 +1,88 @@
+import { FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { LoopCharacterizer } from "../src/loop/LoopCharacterizer.js";
+import { LoopUnroller, UnrollKind } from "../src/loop/LoopUnroller.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int taps(int *frame, const int *weights) {
+    int acc = 0;
+    for (int i = 0; i < 5; i++) {
+        acc = acc + frame[4 - i] * weights[i];
+    }
+    return acc;
+}
+
+int outside(int *a) {
+    int i;
+    int s = 0;
+    for (i = 0; i <= 9; i++) {
+        s += a[i];
+    }
+    return s + i;
+}
+
+int early_exit(int *a) {
+    for (int i = 0; i < 4; i++) {
+        if (a[i] == 0) {
+            break;
+        }
+        for (int j = 0; j < 2; j++) {
+            a[j] = i;
+        }
+    }
+    return 0;
+}
+
+void writes_iv(int *a) {
+    for (int i = 0; i < 4; i++) {
+        a[i] = 0;
+        i++;
+    }
+}
+`;
+
+describe("loop unrolling", () => {
+    registerSourceCodeEach(source);
+
+    test("computes exact trip counts for counted loops", () => {
+        const characterizer = new LoopCharacterizer(true);
+        const loops = Query.search(Loop).get();
+
+        expect(characterizer.getCountedLoop(loops[0])?.tripCount).toBe(5);
+        expect(characterizer.getCountedLoop(loops[1])?.tripCount).toBe(10);
+        expect(characterizer.getCountedLoop(loops[1])?.declaresInductionVar).toBe(false);
+        expect(characterizer.getCountedLoop(Query.search(FunctionJp, { name: "writes_iv" }).first()!.body.children[0] as Loop)).toBeUndefined();
+    });
+
+    test("fully unrolls small loops, replacing the induction variable with literals", () => {
+        const fun = Query.search(FunctionJp, { name: "taps" }).first()!;
+        const unroller = new LoopUnroller({}, true);
+
+        expect(unroller.unroll(Query.searchFrom(fun, Loop).first()!)).toBe(UnrollKind.FULL);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(0);
+        expect(fun.code).toContain("frame[4 - 0] * weights[0]");
+        expect(fun.code).toContain("frame[4 - 4] * weights[4]");
+    });
+
+    test("partially unrolls larger loops with a remainder and the final value", () => {
+        const fun = Query.search(FunctionJp, { name: "outside" }).first()!;
+        const unroller = new LoopUnroller({ maxFullTripCount: 4, factor: 4 }, true);
+
+        expect(unroller.unroll(Query.searchFrom(fun, Loop).first()!)).toBe(UnrollKind.PARTIAL);
+        const code = fun.code;
+        expect(code).toContain("i <= 7");
+        expect(code).toContain("i += 4");
+        expect(code).toContain("a[(i + 3)]");
+        expect(code).toContain("a[9]");
+        expect(code).toContain("i = 10;");
+    });
+
+    test("does not unroll loops that exit early, but does unroll their inner loops", () => {
+        const fun = Query.search(FunctionJp, { name: "early_exit" }).first()!;
+        const unroller = new LoopUnroller({}, true);
+
+        expect(unroller.unrollAllInFunction(fun, false)).toBe(1);
+        expect(Query.searchFrom(fun, Loop).get()).toHaveLength(1);
+    });
+});
@@ -0,0 +1,37 @@
+import { FunctionJp, WrapperStmt } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { Outliner } from "../src/function/Outliner.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int advance(int *p, int n) {
+    int *q = p;
+#pragma clava begin_outline advance_region
+    q = q + n;
+#pragma clava end_outline
+    return *q;
+}
+`;
+
+function getPragmas(fun: FunctionJp): [WrapperStmt, WrapperStmt] {
+    const wrappers = Query.searchFrom(fun, WrapperStmt).get();
+    return [
+        wrappers.find((stmt) => stmt.code.includes("begin_outline"))!,
+        wrappers.find((stmt) => stmt.code.includes("end_outline"))!
+    ];
+}
+
+describe("outlining", () => {
+    registerSourceCodeEach(source);
+
+    test("adds a level of indirection to reassigned pointer parameters", () => {
+        const fun = Query.search(FunctionJp, { name: "advance" }).first()!;
+        const [begin, end] = getPragmas(fun);
+        const [outlined, call] = new Outliner(true).outlineWithWrappers(begin, end);
+
+        expect(outlined).not.toBeNull();
+        expect(outlined!.code).toMatch(/int\s*\*\*\s*q/);
+        expect(outlined!.code).toMatch(/\(\*q\) = \(\*q\) \+/);
+        expect(call!.code).toMatch(/&\s*\(?q\)?/);
+    });
+});
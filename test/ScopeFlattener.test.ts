@@ -12,6 +12,20 @@ int calculate(void) {
     }
     return value;
 }
+
+int sameLine(void) {
+    int acc = 0;
+    { int acc2 = 1; { int acc3 = acc2 + 1; acc = acc3; } }
+    return acc;
+}
+
+int g;
+
+int shadowedGlobal(void) {
+    g = 1;
+    { int g; }
+    return g;
+}
 `;
 
 describe("scope flattening", () => {
@@ -33,4 +47,23 @@ describe("scope flattening", () => {
         expect(names).toContain("value");
         expect(names.some(name => name.includes("test_scope"))).toBe(true);
     });
+
+    test("flattens nested scopes declared on the same line", () => {
+        const fun = Query.search(FunctionJp, { name: "sameLine" }).first()!;
+        const flattener = new ScopeFlattener(true);
+
+        expect(flattener.flattenAllInFunction(fun, true, "test_scope")).toBe(2);
+        expect(Query.searchFrom(fun.body, Scope).get()).toHaveLength(0);
+        expect(fun.code).not.toMatch(/\bacc2\b/);
+    });
+
+    test("does not rename globals shadowed by an unused local", () => {
+        const fun = Query.search(FunctionJp, { name: "shadowedGlobal" }).first()!;
+        const flattener = new ScopeFlattener(true);
+
+        expect(flattener.flattenAllInFunction(fun, true, "test_scope")).toBe(1);
+        expect(fun.code).toMatch(/\bg = 1;/);
+        expect(fun.code).toMatch(/return g;/);
+        expect(fun.code).toMatch(/int test_scope\d*_g;/);
+    });
 });
@@ -0,0 +1,62 @@
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { Speculation } from "../src/Speculation.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int square(int x) {
+    return x * x;
+}
+
+int compute(int a) {
+    int b = square(a);
+    return b + 1;
+}
+`;
+
+describe("speculative transforms", () => {
+    registerSourceCodeEach(source);
+
+    const getFun = (name: string) => Query.search(FunctionJp, { name: name, isImplementation: true }).first()!;
+
+    test("restores the touched functions and removes new ones when rejected", () => {
+        const original = getFun("compute").code;
+        const nFunctions = Query.search(FunctionJp).get().length;
+        const speculation = new Speculation(true);
+
+        const { accepted } = speculation.attempt([getFun("compute")], () => {
+            const fun = getFun("compute");
+            fun.body.insertBegin(ClavaJoinPoints.stmtLiteral("int unused = 0;"));
+            fun.clone("compute_copy");
+            return false;
+        });
+
+        expect(accepted).toBe(false);
+        expect(getFun("compute").code).toBe(original);
+        expect(Query.search(FunctionJp).get()).toHaveLength(nFunctions);
+        expect(speculation.getStats()).toMatchObject({ attempts: 1, accepted: 0, rolledBack: 1 });
+    });
+
+    test("rolls back when the transform throws", () => {
+        const original = getFun("compute").code;
+
+        const { accepted } = new Speculation(true).attempt([getFun("compute")], () => {
+            getFun("compute").body.insertBegin(ClavaJoinPoints.stmtLiteral("int unused = 0;"));
+            throw new Error("failed midway");
+        });
+
+        expect(accepted).toBe(false);
+        expect(getFun("compute").code).toBe(original);
+    });
+
+    test("keeps the changes when accepted", () => {
+        const { accepted } = new Speculation(true).attempt([getFun("compute")], () => {
+            getFun("compute").body.insertBegin(ClavaJoinPoints.stmtLiteral("int kept = 0;"));
+            return true;
+        });
+
+        expect(accepted).toBe(true);
+        expect(getFun("compute").code).toContain("kept");
+    });
+});
@@ -0,0 +1,151 @@
+export type SyntheticProgramOptions = {
+    // number of functions, besides main
+    functions: number,
+    // number of layers of each call graph called by main
+    callDepth: number,
+    // functions per layer; each one calls every function of the next layer, so with 2 or more the call
+    // graphs are chains of diamonds, with as many paths as callWidth^callDepth
+    callWidth: number,
+    // depth of the loop nest in every function, with literal bounds
+    loopDepth: number,
+    structs: number,
+    fieldsPerStruct: number,
+    // rows and columns of the 2D arrays, both local and global
+    arrayRows: number,
+    arrayCols: number,
+    // number of elements of the initializer list of each global table
+    initializerSize: number
+}
+
+export const DEFAULT_SYNTHETIC_OPTIONS: SyntheticProgramOptions = {
+    functions: 16,
+    callDepth: 4,
+    callWidth: 2,
+    loopDepth: 2,
+    structs: 2,
+    fieldsPerStruct: 4,
+    arrayRows: 8,
+    arrayCols: 8,
+    initializerSize: 64
+};
+
+/**
+ * Generates a C program whose size grows with the given options, with every construct the transforms
+ * of this package act on: layered call graphs with fan-in, loop nests with literal bounds, nested scopes,
+ * structs passed by pointer, 2D arrays, constants to fold and propagate, and large initializer lists.
+ */
+export function generateSyntheticProgram(options: Partial<SyntheticProgramOptions> = {}): string {
+    const opts: SyntheticProgramOptions = { ...DEFAULT_SYNTHETIC_OPTIONS, ...options };
+    const lines: string[] = [];
+    const structs = Math.max(1, opts.structs);
+
+    for (let s = 0; s < structs; s++) {
+        lines.push("typedef struct {");
+        for (let f = 0; f < opts.fieldsPerStruct; f++) {
+            lines.push(`    ${f % 2 == 0 ? "int" : "float"} f${f};`);
+        }
+        lines.push(`} s${s}_t;`);
+        lines.push("");
+    }
+
+    const tables = countGraphs(opts);
+    for (let t = 0; t < tables; t++) {
+        const values = Array.from({ length: opts.initializerSize }, (_, i) => (i * 7 + t) % 101);
+        lines.push(`const int table${t}[${opts.initializerSize}] = {${values.join(", ")}};`);
+    }
+    lines.push(`int grid[${opts.arrayRows}][${opts.arrayCols}];`);
+    lines.push("");
+
+    // declared last-to-first, so that every function can call the ones in the next layer
+    for (let i = opts.functions - 1; i >= 0; i--) {
+        lines.push(...generateFunction(i, opts, structs));
+        lines.push("");
+    }
+
+    lines.push("int main(void) {");
+    for (let s = 0; s < structs; s++) {
+        lines.push(`    s${s}_t v${s};`);
+    }
+    for (let i = 0; i < opts.functions; i++) {
+        if (getLayer(i, opts) == 0) {
+            lines.push(`    fun${i}(&v${i % structs}, grid, ${i});`);
+        }
+    }
+    lines.push("    return 0;");
+    lines.push("}");
+
+    return lines.join("\n");
+}
+
+function getGraphSize(opts: SyntheticProgramOptions): number {
+    return Math.max(1, opts.callDepth) * Math.max(1, opts.callWidth);
+}
+
+function countGraphs(opts: SyntheticProgramOptions): number {
+    return Math.max(1, Math.ceil(opts.functions / getGraphSize(opts)));
+}
+
+function getLayer(i: number, opts: SyntheticProgramOptions): number {
+    return Math.floor((i % getGraphSize(opts)) / Math.max(1, opts.callWidth));
+}
+
+/**
+ * Functions of the next layer of the same call graph
+ */
+function getCallees(i: number, opts: SyntheticProgramOptions): number[] {
+    const width = Math.max(1, opts.callWidth);
+    const graphStart = i - (i % getGraphSize(opts));
+    const nextLayer = getLayer(i, opts) + 1;
+    if (nextLayer >= Math.max(1, opts.callDepth)) {
+        return [];
+    }
+    const first = graphStart + nextLayer * width;
+    return Array.from({ length: width }, (_, k) => first + k).filter((j) => j < opts.functions);
+}
+
+function generateFunction(i: number, opts: SyntheticProgramOptions, structs: number): string[] {
+    const s = i % structs;
+    const table = Math.floor(i / getGraphSize(opts)) % countGraphs(opts);
+    const lines: string[] = [];
+
+    lines.push(`void fun${i}(s${s}_t *p, int m[${opts.arrayRows}][${opts.arrayCols}], int n) {`);
+    lines.push(`    int size = ${opts.arrayRows} * ${opts.arrayCols};`);
+    lines.push(`    int scale = size / ${opts.arrayCols};`);
+    lines.push(`    int local[${opts.arrayRows}][${opts.arrayCols}];`);
+    lines.push("    {");
+    lines.push(`        int acc = scale + ${i};`);
+    lines.push("        p->f0 = acc;");
+    lines.push("    }");
+
+    const vars = ["i", "j", "k", "l", "q", "r"];
+    const depth = Math.min(opts.loopDepth, vars.length);
+    let indent = "    ";
+    for (let d = 0; d < depth; d++) {
+        const bound = d % 2 == 0 ? opts.arrayRows : opts.arrayCols;
+        lines.push(`${indent}for (int ${vars[d]} = 0; ${vars[d]} < ${bound}; ${vars[d]}++) {`);
+        indent += "    ";
+    }
+    const row = depth > 0 ? vars[0] : "0";
+    const col = depth > 1 ? vars[1] : "0";
+    lines.push(`${indent}local[${row}][${col}] = m[${row}][${col}] * scale + table${table}[(${row} + ${col}) % ${opts.initializerSize}];`);
+    if (opts.fieldsPerStruct > 1) {
+        lines.push(`${indent}p->f1 = p->f1 + local[${row}][${col}];`);
+    }
+    for (let d = depth - 1; d >= 0; d--) {
+        indent = indent.substring(4);
+        lines.push(`${indent}}`);
+    }
+
+    for (const j of getCallees(i, opts)) {
+        const nextStruct = j % structs;
+        if (nextStruct == s) {
+            lines.push(`    fun${j}(p, local, n + 1);`);
+        }
+        else {
+            lines.push(`    s${nextStruct}_t next${j};`);
+            lines.push(`    fun${j}(&next${j}, local, n + 1);`);
+        }
+    }
+    lines.push("}");
+    return lines;
+}
@@ -16,7 +16,7 @@ Clava.rebuild();
 
 const folder = new FoldingPropagationCombiner();
 for (const fun of Query.search(FunctionJp)) {
-    folder.doPassesUntilStop(fun);
+    folder.doWorklistUntilStop(fun);
 }
 
 Clava.rebuild();
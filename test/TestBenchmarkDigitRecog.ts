@@ -1,28 +1,15 @@
 import Query from "@specs-feup/lara/api/weaver/Query.js";
 import { ArrayFlattener } from "../src/flattening/ArrayFlattener.js";
 import { FoldingPropagationCombiner } from "../src/constfolding/FoldingPropagationCombiner.js";
+import { InitializerBlobs } from "../src/InitializerBlobs.js";
+import { ConstantTableExporter } from "../src/program/ConstantTableExporter.js";
 import { AstDumper } from "./AstDumper.js";
-import { FunctionJp, InitList, Vardecl } from "@specs-feup/clava/api/Joinpoints.js";
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
-import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
-
-function convertExprLit() {
-    for (const decl of Query.search(Vardecl)) {
-        if (decl.children[0] instanceof InitList) {
-            const initList = decl.children[0] as InitList;
-
-            if (initList.children.length > 50) {
-                const exprLit = ClavaJoinPoints.exprLiteral(initList.code);
-                initList.removeChildren();
-                initList.setFirstChild(exprLit);
-            }
-        }
-    }
-}
 
-function flow(enableExprLit: boolean = false) {
-    if (enableExprLit) {
-        convertExprLit();
+function flow(compactInitializers: boolean = false) {
+    if (compactInitializers) {
+        InitializerBlobs.compactAll();
     }
 
     const dumper = new AstDumper();
@@ -31,20 +18,26 @@ function flow(enableExprLit: boolean = false) {
     const arrayFlattener = new ArrayFlattener();
     arrayFlattener.flattenAll();
 
+    // the training and test sets are expanded again by every rebuild, and recompacted right after
     Clava.rebuild();
-    if (enableExprLit) {
-        convertExprLit();
-    }
+    InitializerBlobs.recompact();
 
     const folder = new FoldingPropagationCombiner();
     for (const fun of Query.search(FunctionJp)) {
-        folder.doPassesUntilStop(fun);
+        folder.doWorklistUntilStop(fun);
     }
 
     Clava.rebuild();
-    if (enableExprLit) {
-        convertExprLit();
+    InitializerBlobs.recompact();
+
+    const stats = InitializerBlobs.getStats();
+    console.log(`${stats.blobs} initializer blob(s) with ${stats.elements} elements, compacted ${stats.compactions} time(s)`);
+
+    // keeps the training and test sets out of the woven code, which otherwise takes a long time to compile
+    const tablesDir = process.env.DIGIT_RECOG_TABLES_DIR;
+    if (tablesDir != undefined) {
+        new ConstantTableExporter().exportAll(tablesDir);
     }
 }
 
-flow(true);
\ No newline at end of file
+flow(true);
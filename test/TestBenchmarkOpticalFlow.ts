@@ -5,6 +5,7 @@ import { AstDumper } from "./AstDumper.js";
 import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
 import { StructFlattener } from "../src/flattening/StructFlattener.js";
+import { TransformSession } from "../src/TransformSession.js";
 
 const dumper = new AstDumper();
 console.log(dumper.dump());
@@ -16,7 +17,7 @@ Clava.rebuild();
 
 const folder = new FoldingPropagationCombiner();
 for (const fun of Query.search(FunctionJp)) {
-    folder.doPassesUntilStop(fun);
+    folder.doWorklistUntilStop(fun);
 }
 
 Clava.rebuild();
@@ -28,9 +29,10 @@ const structs = [
     "velocity_t"
 ]
 
+const session = new TransformSession();
 const structDecomp = new StructFlattener();
-for (const struct of structs) {
-    structDecomp.flattenByName(struct);
-}
-
-Clava.rebuild();
\ No newline at end of file
+session.run(() => {
+    for (const struct of structs) {
+        structDecomp.flattenByName(struct);
+    }
+});
\ No newline at end of file
@@ -1,19 +1,12 @@
-import Query from "@specs-feup/lara/api/weaver/Query.js";
-import { ArrayFlattener } from "../src/flattening/ArrayFlattener.js";
-import { FoldingPropagationCombiner } from "../src/constfolding/FoldingPropagationCombiner.js";
+import { PipelinePasses, TransformPipeline } from "../src/pipeline/TransformPipeline.js";
 import { AstDumper } from "./AstDumper.js";
-import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
-import Clava from "@specs-feup/clava/api/clava/Clava.js";
 
 const dumper = new AstDumper();
 console.log(dumper.dump());
 
-const arrayFlattener = new ArrayFlattener();
-arrayFlattener.flattenAll();
-
-Clava.rebuild();
-
-const folder = new FoldingPropagationCombiner();
-for (const fun of Query.search(FunctionJp)) {
-    folder.doPassesUntilStop(fun);
-}
\ No newline at end of file
+const pipeline = new TransformPipeline([
+    PipelinePasses.arrayFlattening(),
+    PipelinePasses.constantFolding(true, false)
+]);
+pipeline.run();
+pipeline.writeReport("arrayflat-constprop-report.json");
@@ -0,0 +1,11 @@
+import os from "node:os";
+import { ParallelDriver } from "../src/program/ParallelDriver.js";
+
+const workers = Number(process.argv[2] ?? os.cpus().length);
+const driver = new ParallelDriver({ workers: workers, clavaArgs: ["-std", "c11"] });
+const report = await driver.run("inputs/mser", "output/parallel-mser");
+
+for (const worker of report.workers) {
+    console.log(`Partition ${worker.partition}: ${worker.files.length} files, ${worker.wallTimeMs} ms, ${JSON.stringify(worker.counts)}`);
+}
+console.log(`Parallel time with ${workers} workers: ${report.parallelTimeMs} ms`);
@@ -0,0 +1,126 @@
+import fs from "node:fs";
+import Clava from "@specs-feup/clava/api/clava/Clava.js";
+import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FunctionJp, Loop } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { FoldingPropagationCombiner } from "../src/constfolding/FoldingPropagationCombiner.js";
+import { ArrayFlattener } from "../src/flattening/ArrayFlattener.js";
+import { LightStructFlattener } from "../src/flattening/LightStructFlattener.js";
+import { ScopeFlattener } from "../src/flattening/ScopeFlattener.js";
+import { StructFlattener } from "../src/flattening/StructFlattener.js";
+import { CallTreeInliner } from "../src/function/CallTreeInliner.js";
+import { LoopCharacterizer } from "../src/loop/LoopCharacterizer.js";
+import { Amalgamator } from "../src/program/Amalgamator.js";
+import { CallGraph } from "../src/program/CallGraph.js";
+import { generateSyntheticProgram, SyntheticProgramOptions } from "./SyntheticProgram.js";
+
+type Sample = { size: number, joinpoints: number, timeMs: number, heapDeltaMB: number };
+
+/**
+ * One option of the generator, varied while the others keep their defaults (and fixed values)
+ */
+type Sweep = { option: keyof SyntheticProgramOptions, sizes: number[], fixed: Partial<SyntheticProgramOptions> };
+
+const implementations = () => Query.search(FunctionJp, { isImplementation: true }).get();
+
+const transforms: Record<string, () => void> = {
+    CallGraph: () => {
+        CallGraph.invalidate();
+        CallGraph.get();
+    },
+    ScopeFlattener: () => {
+        const flattener = new ScopeFlattener(true);
+        implementations().forEach((fun) => flattener.flattenAllInFunction(fun));
+    },
+    ArrayFlattener: () => {
+        new ArrayFlattener(true).flattenAll();
+    },
+    FoldingPropagation: () => {
+        const folder = new FoldingPropagationCombiner(true);
+        implementations().forEach((fun) => folder.doWorklistUntilStop(fun));
+    },
+    LoopCharacterizer: () => {
+        const characterizer = new LoopCharacterizer(true);
+        Query.search(Loop).get().forEach((loop) => characterizer.characterize(loop));
+    },
+    StructFlattener: () => {
+        new StructFlattener(new LightStructFlattener(true), true).flattenAll();
+    },
+    CallTreeInliner: () => {
+        const main = Query.search(FunctionJp, { name: "main", isImplementation: true }).first()!;
+        new CallTreeInliner(true).inlineCallTreeBottomUp(main, false);
+    },
+    Amalgamator: () => {
+        new Amalgamator(true).amalgamate("scalability_amalgamated");
+    }
+};
+
+/**
+ * Exponent k of time ~ size^k, fitted between the smallest and the largest sizes
+ */
+function growthExponent(samples: Sample[]): number {
+    const first = samples[0];
+    const last = samples[samples.length - 1];
+    return Math.log(Math.max(last.timeMs, 1) / Math.max(first.timeMs, 1)) / Math.log(last.size / first.size);
+}
+
+function classify(k: number): string {
+    if (k < 1.5) {
+        return "linear";
+    }
+    if (k < 2.5) {
+        return "quadratic";
+    }
+    return "super-quadratic (possibly exponential)";
+}
+
+function measure(name: string, sweep: Sweep, size: number): Sample {
+    const options = { ...sweep.fixed, [sweep.option]: size };
+    Clava.getProgram().push();
+    const program = Clava.getProgram();
+    program.addFile(ClavaJoinPoints.fileWithSource(`synthetic_${sweep.option}_${size}.c`, generateSyntheticProgram(options)));
+    program.rebuild();
+    CallGraph.invalidate();
+
+    const joinpoints = program.descendants.length;
+    const heapBefore = process.memoryUsage().heapUsed;
+    const start = Date.now();
+    transforms[name]();
+    const timeMs = Date.now() - start;
+    const heapDeltaMB = Math.round((process.memoryUsage().heapUsed - heapBefore) / 1024 / 1024 * 10) / 10;
+
+    Clava.getProgram().pop();
+    CallGraph.invalidate();
+    return { size: size, joinpoints: joinpoints, timeMs: timeMs, heapDeltaMB: heapDeltaMB };
+}
+
+const sizesOf = (variable: string, defaults: string) => (process.env[variable] ?? defaults).split(",").map(Number);
+
+// call depth is swept with a fixed number of functions, in diamond-shaped call graphs whose number of paths
+// doubles with each layer (and so does the code inlined by CallTreeInliner, hence the small depths)
+const sweeps: Sweep[] = [
+    { option: "functions", sizes: sizesOf("SCALABILITY_SIZES", "8,16,32,64"), fixed: {} },
+    { option: "callDepth", sizes: sizesOf("SCALABILITY_DEPTHS", "2,4,6,8"), fixed: { functions: 32, callWidth: 2 } },
+    { option: "structs", sizes: sizesOf("SCALABILITY_STRUCTS", "2,4,8,16"), fixed: {} },
+    { option: "fieldsPerStruct", sizes: sizesOf("SCALABILITY_FIELDS", "4,8,16,32"), fixed: {} },
+    { option: "initializerSize", sizes: sizesOf("SCALABILITY_INITIALIZERS", "64,256,1024,4096"), fixed: {} }
+];
+const selected = process.env.SCALABILITY_SWEEPS?.split(",");
+const report: Record<string, Record<string, { samples: Sample[], exponent: number, growth: string }>> = {};
+
+for (const sweep of sweeps.filter((sweep) => selected == undefined || selected.includes(sweep.option))) {
+    console.log(`Varying ${sweep.option}:`);
+    report[sweep.option] = {};
+
+    for (const name of Object.keys(transforms)) {
+        const samples = sweep.sizes.map((size) => measure(name, sweep, size));
+        const exponent = growthExponent(samples);
+        report[sweep.option][name] = { samples: samples, exponent: Math.round(exponent * 100) / 100, growth: classify(exponent) };
+
+        const times = samples.map((s) => `${s.size}:${s.timeMs}ms`).join(" ");
+        console.log(`    ${name.padEnd(20)} ${times}  k=${report[sweep.option][name].exponent} (${report[sweep.option][name].growth})`);
+    }
+}
+
+fs.writeFileSync("scalability-report.json", JSON.stringify(report, null, 4));
+console.log("Wrote scalability-report.json");
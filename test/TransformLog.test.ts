@@ -0,0 +1,64 @@
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { AdvancedTransform } from "../src/AdvancedTransform.js";
+import { LogEvent, TransformLog } from "../src/TransformLog.js";
+
+class LoggingTransform extends AdvancedTransform {
+    constructor(silent: boolean) {
+        super("LoggingTransform", silent);
+    }
+
+    public emit(msg: () => string, level: "DEBUG" | "INFO" | "WARN"): void {
+        this.log(msg, level, { site: "test" });
+    }
+}
+
+describe("transform logging", () => {
+    let sink: string;
+
+    beforeEach(() => {
+        sink = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "log-")), "log.jsonl");
+        TransformLog.setConsoleOutput(false);
+        TransformLog.setLevel("INFO");
+    });
+
+    afterEach(() => {
+        TransformLog.setJsonlSink(undefined);
+        TransformLog.setConsoleOutput(true);
+        TransformLog.setLevel("INFO");
+        fs.rmSync(path.dirname(sink), { recursive: true, force: true });
+    });
+
+    test("does not build messages that are filtered out", () => {
+        TransformLog.setJsonlSink(sink);
+        let built = 0;
+        const msg = () => `expensive ${++built}`;
+
+        new LoggingTransform(true).emit(msg, "INFO");
+        new LoggingTransform(false).emit(msg, "DEBUG");
+        expect(built).toBe(0);
+
+        new LoggingTransform(true).emit(msg, "WARN");
+        expect(built).toBe(1);
+    });
+
+    test("costs nothing without console or sink", () => {
+        let built = 0;
+        new LoggingTransform(false).emit(() => `expensive ${++built}`, "WARN");
+        expect(built).toBe(0);
+    });
+
+    test("writes one JSON event per line to the sink", () => {
+        TransformLog.setJsonlSink(sink);
+        TransformLog.setLevel("DEBUG");
+        const transform = new LoggingTransform(false);
+
+        transform.emit(() => "first", "DEBUG");
+        transform.emit(() => "second", "INFO");
+
+        const events = fs.readFileSync(sink, "utf8").trim().split("\n").map((line) => JSON.parse(line) as LogEvent);
+        expect(events.map((event) => event.message)).toEqual(["first", "second"]);
+        expect(events[0]).toMatchObject({ transform: "LoggingTransform", level: "DEBUG", data: { site: "test" } });
+    });
+});
@@ -0,0 +1,147 @@
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
+import Query from "@specs-feup/lara/api/weaver/Query.js";
+import { ArrayFlattener } from "../src/flattening/ArrayFlattener.js";
+import { StructFlattener } from "../src/flattening/StructFlattener.js";
+import { CallTreeInliner } from "../src/function/CallTreeInliner.js";
+import { MallocHoister } from "../src/hoisting/MallocHoister.js";
+import { registerSourceCodeEach } from "./jestHelpers.js";
+
+const source = `
+int grid[4][8];
+
+void fill(int m[4][8], int v) {
+    for (int i = 0; i < 4; i++) {
+        m[i][0] = v;
+    }
+}
+
+int get(int x) {
+    return x;
+}
+
+void top(void) {
+    int local[2][2];
+    local[0][1] = get(1);
+    fill(grid, 3);
+}
+`;
+
+describe("transform plans", () => {
+    registerSourceCodeEach(source);
+
+    test("plans array flattening without changing the AST", () => {
+        const before = Query.search(FunctionJp, { name: "top" }).first()!.code;
+        const plan = new ArrayFlattener(true).planFlattenAll();
+
+        const sites = plan.candidates.map((c) => c.site.split(" ")[0]);
+        expect(sites).toEqual(expect.arrayContaining(["grid", "local"]));
+        expect(plan.estimatedBenefit.arraysFlattened).toBe(plan.legal);
+        expect(plan.candidates.find((c) => c.site.startsWith("local"))?.benefit.accessesRewritten).toBe(1);
+        expect(Query.search(FunctionJp, { name: "top" }).first()!.code).toBe(before);
+    });
+
+    test("plans call tree inlining with legality verdicts", () => {
+        const top = Query.search(FunctionJp, { name: "top" }).first()!;
+        const plan = new CallTreeInliner(true).planInlineCallTree(top);
+
+        const fill = plan.candidates.find((c) => c.site.startsWith("fill"))!;
+        const get = plan.candidates.find((c) => c.site.startsWith("get"))!;
+        expect(fill.legal).toBe(true);
+        expect(fill.benefit.statementsCloned).toBeGreaterThan(0);
+        expect(get.legal).toBe(false);
+        expect(get.reasons).toContain("Callee get() is not void");
+    });
+});
+
+const structSource = `
+#include <stdlib.h>
+
+typedef struct {
+    int x;
+    float y;
+} point_t;
+
+typedef struct {
+    int a;
+    int b;
+} pair_t;
+
+pair_t *make_pair(void) {
+    return (pair_t *)malloc(sizeof(pair_t));
+}
+
+int main(void) {
+    point_t p;
+    p.x = 1;
+    pair_t *q = make_pair();
+    q->a = 2;
+    return p.x + q->a;
+}
+`;
+
+describe("struct flattening plans", () => {
+    registerSourceCodeEach(structSource);
+
+    test("gives the same verdicts that flattening applies", () => {
+        const flattener = new StructFlattener(undefined, true);
+        const plan = flattener.planFlattenAll();
+
+        const point = plan.candidates.find((c) => c.site === "struct point_t")!;
+        const pair = plan.candidates.find((c) => c.site === "struct pair_t")!;
+        expect(point.legal).toBe(true);
+        expect(point.benefit.declsRewritten).toBe(1);
+        expect(point.benefit.accessesRewritten).toBe(2);
+        expect(pair.legal).toBe(false);
+        expect(pair.reasons).toContain("Returned by make_pair(), and return values are not flattened");
+
+        expect(flattener.flattenAll()).toEqual(["point_t"]);
+    });
+});
+
+const mallocSource = `
+#include <stdlib.h>
+
+void nested(int **out) {
+    *out = (int *)malloc(4 * sizeof(int));
+}
+
+int *alloc_buf(void) {
+    int *buf;
+    nested(&buf);
+    buf = (int *)malloc(8 * sizeof(int));
+    return buf;
+}
+
+void fill(int **out) {
+    *out = (int *)malloc(16 * sizeof(int));
+}
+
+int main(void) {
+    int *a;
+    fill(&a);
+    int *b = alloc_buf();
+    free(a);
+    free(b);
+    return 0;
+}
+`;
+
+describe("malloc hoisting plans", () => {
+    registerSourceCodeEach(mallocSource);
+
+    test("only accepts mallocs in callees the inliner would inline", () => {
+        const main = Query.search(FunctionJp, { name: "main" }).first()!;
+        const plan = new MallocHoister(true).planHoistAllMallocs(main);
+
+        const inFill = plan.candidates.find((c) => c.function === "fill")!;
+        const inAllocBuf = plan.candidates.find((c) => c.function === "alloc_buf")!;
+        const inNested = plan.candidates.find((c) => c.function === "nested")!;
+
+        expect(inFill.legal).toBe(true);
+        expect(inFill.reasons).toContain("Requires inlining fill() into main()");
+        expect(inAllocBuf.legal).toBe(false);
+        expect(inAllocBuf.reasons.join("\n")).toContain("Callee alloc_buf() is not void");
+        expect(inNested.legal).toBe(false);
+        expect(inNested.reasons.join("\n")).toContain("Only called from functions that cannot be inlined");
+    });
+});
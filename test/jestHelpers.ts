@@ -1,5 +1,6 @@
 import Clava from "@specs-feup/clava/api/clava/Clava.js";
 import ClavaJoinPoints from "@specs-feup/clava/api/clava/ClavaJoinPoints.js";
+import { FunctionJp } from "@specs-feup/clava/api/Joinpoints.js";
 import { LaraJoinPoint } from "@specs-feup/lara/api/LaraJoinPoint.js";
 import { Filter_WrapperVariant } from "@specs-feup/lara/api/weaver/Selector.js";
 import Query from "@specs-feup/lara/api/weaver/Query.js";
@@ -44,6 +45,13 @@ export function registerSourceCodeEach(code: string): void {
   });
 }
 
+/**
+ * Returns the function with the given name in the registered source code
+ */
+export function getFunction(name: string): FunctionJp {
+  return Query.search(FunctionJp, { name: name }).first()!;
+}
+
 /**
  * In contrast to registerSourceCode, this simply pushes the AST onto the stack
  * and then loads the code. It is up to the user to pop the AST after they're done